@@ -0,0 +1,224 @@
+#ifndef ACQUISITION_PIPELINE_H
+#define ACQUISITION_PIPELINE_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+/**
+ * @brief Branch-free compare and swap, leaves the smaller value in a.
+ * @param a The first value.
+ * @param b The second value.
+ */
+static inline void compareSwap(int32_t& a, int32_t& b)
+{
+    int32_t d = b - a;
+    int32_t m = d & (d >> 31);  // d if b < a, else 0
+    a += m;
+    b -= m;
+}
+
+// Source stage policies. read() returns one raw 10-bit conversion of the input.
+
+/// @brief The ESP8266 ADC. \struct AnalogSource
+struct AnalogSource
+{
+    static uint16_t read(uint8_t pin) { return analogRead(pin); }
+};
+
+// Filter stage policies. Each takes READS raw readings through add() and returns the filtered
+// value from result(); the acquisition loop only performs READS conversions.
+
+/// @brief Plain mean of N readings, keeps only the running sum. \struct MeanCombiner
+template <uint8_t N>
+struct MeanCombiner
+{
+    static constexpr uint8_t READS = N;
+    uint32_t sum = 0;
+
+    void add(uint8_t, uint16_t value) { sum += value; }
+    uint16_t result() const { return sum / N; }
+};
+
+/// @brief Mean of a circular running median of 3, insensitive to isolated spikes. \struct Median3Combiner
+template <uint8_t N>
+struct Median3Combiner
+{
+    static_assert(N == 16, "combiner shifts assume 16 readings");
+    static constexpr uint8_t READS = N;
+    uint16_t reads[N];
+
+    void add(uint8_t i, uint16_t value) { reads[i] = value; }
+
+    uint16_t result() const
+    {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < N; i++)
+        {
+            int32_t a = reads[i];
+            int32_t b = reads[(i + 1) % N];
+            int32_t c = reads[(i + 2) % N];
+
+            // 3-input sorting network, b ends up as the median
+            compareSwap(a, b);
+            compareSwap(b, c);
+            compareSwap(a, b);
+            sum += b;
+        }
+
+        return sum >> 4;
+    }
+};
+
+/// @brief Mean of the two middle values of every block of 4 readings. \struct TrimmedCombiner
+template <uint8_t N>
+struct TrimmedCombiner
+{
+    static_assert(N == 16, "combiner shifts assume 16 readings");
+    static constexpr uint8_t READS = N;
+    uint16_t reads[N];
+
+    void add(uint8_t i, uint16_t value) { reads[i] = value; }
+
+    uint16_t result() const
+    {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < N; i += 4)
+        {
+            int32_t a = reads[i];
+            int32_t b = reads[i + 1];
+            int32_t c = reads[i + 2];
+            int32_t d = reads[i + 3];
+
+            // optimal 4-input sorting network (5 comparators), drop min and max
+            compareSwap(a, b);
+            compareSwap(c, d);
+            compareSwap(a, c);
+            compareSwap(b, d);
+            compareSwap(b, c);
+            sum += b + c;
+        }
+
+        return sum >> 3;  // 8 kept readings
+    }
+};
+
+/// @brief No filter stage, a single conversion per value. \struct SingleReadCombiner
+struct SingleReadCombiner
+{
+    static constexpr uint8_t READS = 1;
+    uint16_t value = 0;
+
+    void add(uint8_t, uint16_t v) { value = v; }
+    uint16_t result() const { return value; }
+};
+
+// Trigger stage policies. fires() is asked with every filtered value polled once the dead time has
+// passed and decides whether a capture starts.
+
+/// @brief Fires on every poll at or above the threshold. \struct LevelTrigger
+struct LevelTrigger
+{
+    bool fires(uint16_t value, uint16_t threshold) { return value >= threshold; }
+};
+
+/// @brief Fires once per excursion above the threshold, a poll below it re-arms. \struct EdgeTrigger
+///
+/// A saturated input or a long pile-up tail is counted once instead of once per dead time.
+struct EdgeTrigger
+{
+    bool armed = true;
+
+    bool fires(uint16_t value, uint16_t threshold)
+    {
+        bool crossed = armed && value >= threshold;
+        armed = value < threshold;
+        return crossed;
+    }
+};
+
+// Capture stage policies. sample() converts one waveform sample at the scheduled time.
+
+/// @brief Every sample passes the filter stage, less noise but OVERSAMPLE_COUNT conversions long. \struct FilteredCapture
+struct FilteredCapture
+{
+    template <typename Detector>
+    static uint16_t sample(Detector& detector) { return detector.overSample(true); }
+};
+
+/// @brief Every sample is a single conversion, the schedule is kept down to the ADC conversion time. \struct RawCapture
+struct RawCapture
+{
+    template <typename Detector>
+    static uint16_t sample(Detector& detector) { return detector.readADC(); }
+};
+
+// Analyzer stage policies. analyze() turns a captured pulse into the features and the class.
+
+/// @brief Pulse shape discrimination with the feature kernels and the soft classifier. \struct PulseShapeAnalyzer
+struct PulseShapeAnalyzer
+{
+    template <typename Detector>
+    static typename Detector::PulseAnalysis analyze(const Detector& detector, const typename Detector::Pulse& pulse)
+    {
+        return detector.analyzePulse(pulse);
+    }
+};
+
+/// @brief No pulse shape analysis, every trigger is a neutron, e.g. for a He-3 or BF3 counter. \struct CountingAnalyzer
+struct CountingAnalyzer
+{
+    template <typename Detector>
+    static typename Detector::PulseAnalysis analyze(const Detector& detector, const typename Detector::Pulse& pulse)
+    {
+        typename Detector::PulseAnalysis result = {};
+        result.baseline = pulse.baseline * 4.0f;
+        result.threshold = detector._threshold;
+        result.neutronProbability = 1.0f;
+        result.isNeutron = true;
+        return result;
+    }
+};
+
+/**
+ * @brief Compile-time list of event sinks fed with every counted neutron. \class EventSinks
+ *
+ * Every stage needs addEvent(uint64_t). The calls are expanded in place, so a deployment drops a
+ * sink by leaving it out of the list and pays nothing for it.
+ */
+template <typename... Stages>
+class EventSinks : private Stages...
+{
+public:
+
+    /**
+     * @brief Check at compile time whether a stage is part of the list.
+     * @return true if Stage is one of the sinks.
+     */
+    template <typename Stage>
+    static constexpr bool has()
+    {
+        return (std::is_same<Stage, Stages>::value || ...);
+    }
+
+    /**
+     * @brief Feed a neutron event to every sink, in list order.
+     * @param timestamp The event time in microseconds.
+     */
+    void addEvent(uint64_t timestamp)
+    {
+        (void)timestamp;    // unused with an empty list
+        (static_cast<Stages&>(*this).addEvent(timestamp), ...);
+    }
+
+    /**
+     * @brief Run a function on one stage, compiled away if the stage is not in the list.
+     * @param function Called with a reference to the stage.
+     */
+    template <typename Stage, typename Function>
+    void apply(Function function)
+    {
+        if constexpr (has<Stage>()) function(static_cast<Stage&>(*this));
+    }
+};
+
+#endif // ACQUISITION_PIPELINE_H
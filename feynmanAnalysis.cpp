@@ -0,0 +1,109 @@
+#include "feynmanAnalysis.h"
+
+void FeynmanAnalysis::setDeadTime(uint32_t deadTimeUs)
+{
+    _deadTimeUs = deadTimeUs;
+    _baseGateUs = max(DEAD_TIME_GATES * deadTimeUs, DEFAULT_BASE_GATE_US);
+    reset();
+}
+
+bool FeynmanAnalysis::configure(uint32_t baseGateUs)
+{
+    baseGateUs = baseGateUs > 0 ? baseGateUs : max(DEAD_TIME_GATES * _deadTimeUs, DEFAULT_BASE_GATE_US);
+
+    // a gate inside the dead time holds at most one event, its Y is -mean whatever the source does
+    if (baseGateUs < _deadTimeUs) return false;
+
+    _baseGateUs = baseGateUs;
+    reset();
+    return true;
+}
+
+void FeynmanAnalysis::reset()
+{
+    _started = false;
+    memset(_gates, 0, sizeof(_gates));
+}
+
+void FeynmanAnalysis::addEvent(uint64_t timestamp)
+{
+    if (!_started)
+    {
+        for (uint8_t k = 0; k < GATE_WIDTHS; k++)
+        {
+            _gates[k].end = timestamp + ((uint64_t)_baseGateUs << k);
+        }
+        _started = true;
+    }
+
+    for (uint8_t k = 0; k < GATE_WIDTHS; k++)
+    {
+        Gate& g = _gates[k];
+        const uint64_t width = (uint64_t)_baseGateUs << k;
+
+        if (timestamp >= g.end)
+        {
+            // close the open gate, every gate skipped since then was empty and only adds to the gate count
+            g.gates++;
+            g.sum += g.count;
+            g.sumSquares += (uint64_t)g.count * g.count;
+
+            const uint64_t skipped = (timestamp - g.end) / width;
+            g.gates += skipped;
+            g.end += (skipped + 1) * width;
+            g.count = 0;
+        }
+        g.count++;
+    }
+}
+
+float FeynmanAnalysis::computeY(uint8_t k) const
+{
+    const Gate& g = _gates[k];
+    if (g.gates == 0 || g.sum == 0) return 0.0f;
+
+    const float mean = (float)g.sum / g.gates;
+    const float variance = (float)g.sumSquares / g.gates - mean * mean;
+    return variance / mean - 1.0f;
+}
+
+float FeynmanAnalysis::deadTimeBias(uint32_t deadTimeUs, uint32_t gateUs, float triggerRateHz, float neutronFraction)
+{
+    if (triggerRateHz <= 0 || gateUs == 0) return 0.0f;
+
+    // intervals are tau plus an exponential wait, x = M tau is the busy fraction; with the raw moments
+    // m2 = E[X^2] / E[X]^2 and m3 = E[X^3] / E[X]^3, C = m2^2 / 2 - m3 / 3
+    const float x = min(triggerRateHz * deadTimeUs / 1000000.0f, 1.0f);
+    const float w = 1.0f - x;
+    const float m2 = x * x - 2 * x + 2;
+    const float m3 = x * x * x + 3 * x * x * w + 6 * x * w * w + 6 * w * w * w;
+    const float c = m2 * m2 / 2 - m3 / 3;
+    return neutronFraction * (w * w - 1.0f + c * 1000000.0f / (triggerRateHz * gateUs));
+}
+
+void FeynmanAnalysis::toJSON(JsonDocument& doc, float triggerRateHz, float neutronFraction) const
+{
+    doc["dead_time_us"] = _deadTimeUs;
+    doc["trigger_rate_hz"] = triggerRateHz;
+    doc["neutron_fraction"] = neutronFraction;
+    doc["base_gate_us"] = _baseGateUs;
+
+    JsonArray widths = doc.createNestedArray("gate_us");
+    JsonArray y = doc.createNestedArray("y");
+    JsonArray bias = doc.createNestedArray("dead_time_bias");
+    JsonArray corrected = doc.createNestedArray("y_corrected");
+    JsonArray gates = doc.createNestedArray("gates");
+    JsonArray mean = doc.createNestedArray("mean");
+
+    for (uint8_t k = 0; k < GATE_WIDTHS; k++)
+    {
+        const Gate& g = _gates[k];
+        widths.add(_baseGateUs << k);
+        const float b = deadTimeBias(_deadTimeUs, _baseGateUs << k, triggerRateHz, neutronFraction);
+        y.add(computeY(k));
+        bias.add(b);
+        corrected.add(g.sum > 0 ? computeY(k) - b : 0.0f);
+        gates.add(g.gates);
+        mean.add(g.gates > 0 ? (float)g.sum / g.gates : 0.0f);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef FEYNMAN_ANALYSIS_H
+#define FEYNMAN_ANALYSIS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/// @brief Feynman-Y variance-to-mean analysis over geometrically spaced gate widths. \class FeynmanAnalysis
+class FeynmanAnalysis
+{
+public:
+
+    static constexpr uint8_t GATE_WIDTHS = 12;
+    static constexpr uint32_t DEFAULT_BASE_GATE_US = 16;
+    static constexpr uint8_t DEAD_TIME_GATES = 2;       // the narrowest default gate spans this many dead times
+
+    /**
+     * @brief Set the dead time of the trigger and start the gate ladder above it, clears the results.
+     * @param deadTimeUs The shortest interval between two recorded events in microseconds.
+     */
+    void setDeadTime(uint32_t deadTimeUs);
+
+    /**
+     * @brief Set the narrowest gate width, width k is base * 2^k, clears the results.
+     * @param baseGateUs The narrowest gate width in microseconds, 0 for the default, at least the dead time.
+     * @return false if the narrowest gate is shorter than the dead time, nothing is changed then.
+     */
+    bool configure(uint32_t baseGateUs);
+
+    /**
+     * @brief The Y a non-paralyzable dead time alone gives a Poisson source.
+     *
+     * The dead time turns the trigger stream into a renewal process, Y(T) = CV^2 - 1 + C / (M T) up to
+     * terms that decay exponentially in T; an independently classified fraction f keeps f times that.
+     * @param deadTimeUs The dead time in microseconds.
+     * @param gateUs The gate width T in microseconds, at least the dead time.
+     * @param triggerRateHz The measured trigger rate M, all pulses.
+     * @param neutronFraction The fraction f of the triggers fed to the analysis.
+     * @return float The bias to subtract from Y.
+     */
+    static float deadTimeBias(uint32_t deadTimeUs, uint32_t gateUs, float triggerRateHz, float neutronFraction);
+
+    /**
+     * @brief Clear the accumulated moments, the gate grid restarts at the next event.
+     */
+    void reset();
+
+    /**
+     * @brief Feed a neutron event, events must arrive in time order.
+     * @param timestamp The event time in microseconds.
+     */
+    void addEvent(uint64_t timestamp);
+
+    /**
+     * @brief Compute the Feynman-Y value of one gate width from the closed gates.
+     * @param k The gate width index.
+     * @return float Y = variance / mean - 1, or 0 without counts.
+     */
+    float computeY(uint8_t k) const;
+
+    /**
+     * @brief Add the Y(T) curve, the dead time corrected curve and the raw moments to a JSON document.
+     * @param doc The JSON document to fill.
+     * @param triggerRateHz The measured rate of all triggers, neutron or not.
+     * @param neutronFraction The fraction of the triggers fed to the analysis.
+     */
+    void toJSON(JsonDocument& doc, float triggerRateHz = 0, float neutronFraction = 0) const;
+
+private:
+    /// @brief Contiguous gate counter and running moments of one width. \struct Gate
+    struct Gate
+    {
+        uint64_t end;
+        uint32_t count;
+        uint64_t gates;
+        uint64_t sum;
+        uint64_t sumSquares;
+    };
+
+    uint32_t _deadTimeUs = 0;
+    uint32_t _baseGateUs = DEFAULT_BASE_GATE_US;
+    bool _started = false;
+    Gate _gates[GATE_WIDTHS] = {};
+};
+
+#endif // FEYNMAN_ANALYSIS_H
@@ -0,0 +1,67 @@
+#include "frameRing.h"
+
+bool FrameRing::publish(const char* data, uint16_t length)
+{
+    if (length == 0 || length > BUFFER_SIZE) return false;
+
+    if (_writeOffset + length > BUFFER_SIZE)
+    {
+        // the frames past the write offset are the oldest ones, they go first
+        while (_tail != _head && _frames[_tail % MAX_FRAMES].offset >= _writeOffset)
+        {
+            evict();
+        }
+        _writeOffset = 0;
+    }
+
+    const uint16_t end = _writeOffset + length;
+    while (_tail != _head)
+    {
+        const Entry& oldest = _frames[_tail % MAX_FRAMES];
+        bool overlaps = oldest.offset < end && oldest.offset + oldest.length > _writeOffset;
+        if (!overlaps && _head - _tail < MAX_FRAMES) break;
+        evict();
+    }
+
+    memcpy(_buffer + _writeOffset, data, length);
+    _frames[_head % MAX_FRAMES] = { _writeOffset, length };
+    _head++;
+    _writeOffset = end;
+    return true;
+}
+
+uint32_t FrameRing::head() const
+{
+    return _head;
+}
+
+uint32_t FrameRing::tail() const
+{
+    return _tail;
+}
+
+bool FrameRing::getFrame(uint32_t seq, const char*& data, uint16_t& length) const
+{
+    if ((int32_t)(seq - _tail) < 0 || (int32_t)(seq - _head) >= 0) return false;
+
+    const Entry& e = _frames[seq % MAX_FRAMES];
+    data = _buffer + e.offset;
+    length = e.length;
+    return true;
+}
+
+uint32_t FrameRing::clampCursor(uint32_t& cursor) const
+{
+    if ((int32_t)(cursor - _head) > 0) cursor = _head;  // cursor from before a reboot
+
+    if ((int32_t)(cursor - _tail) >= 0) return 0;
+
+    uint32_t skipped = _tail - cursor;
+    cursor = _tail;
+    return skipped;
+}
+
+void FrameRing::evict()
+{
+    _tail++;
+}
@@ -0,0 +1,69 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <Arduino.h>
+
+/// @brief Shared ring of encoded frames read by any number of cursor-only subscribers. \class FrameRing
+class FrameRing
+{
+public:
+
+    static constexpr uint16_t BUFFER_SIZE = 4096;
+    static constexpr uint8_t MAX_FRAMES = 32;
+
+    /**
+     * @brief Append an encoded frame, evicting the oldest frames it overwrites.
+     * @param data The encoded frame.
+     * @param length The length of the frame in bytes.
+     * @return true if the frame was stored, false if it is larger than the buffer.
+     */
+    bool publish(const char* data, uint16_t length);
+
+    /**
+     * @brief Get the sequence number the next published frame will receive.
+     * @return uint32_t The head sequence number.
+     */
+    uint32_t head() const;
+
+    /**
+     * @brief Get the sequence number of the oldest retained frame.
+     * @return uint32_t The tail sequence number.
+     */
+    uint32_t tail() const;
+
+    /**
+     * @brief Get a retained frame by sequence number.
+     * @param seq The sequence number of the frame.
+     * @param data Receives a pointer to the frame bytes.
+     * @param length Receives the length of the frame.
+     * @return true if the frame is still retained, false otherwise.
+     */
+    bool getFrame(uint32_t seq, const char*& data, uint16_t& length) const;
+
+    /**
+     * @brief Clamp a subscriber cursor to the retained frames.
+     * @param cursor The subscriber cursor, moved to the oldest retained frame if it fell behind.
+     * @return uint32_t The number of frames the subscriber missed.
+     */
+    uint32_t clampCursor(uint32_t& cursor) const;
+
+private:
+    struct Entry
+    {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    char _buffer[BUFFER_SIZE];
+    Entry _frames[MAX_FRAMES];
+    uint32_t _head = 0;
+    uint32_t _tail = 0;
+    uint16_t _writeOffset = 0;
+
+    /**
+     * @brief Drop the oldest frame.
+     */
+    void evict();
+};
+
+#endif // FRAME_RING_H
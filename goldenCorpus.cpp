@@ -0,0 +1,40 @@
+#include "goldenCorpus.h"
+
+// Synthetic waveforms only: (exp(-t/decay) - exp(-t/rise)) pulses starting 15 us into the window
+// with +/-1 count of deterministic noise.
+const GoldenWaveform GOLDEN_CORPUS[] PROGMEM = {
+    // neutron, rise tau 14 us, decay tau 60 us
+    { GOLDEN_NEUTRON, 128.0f,
+      { 129, 127, 142, 158, 161, 161, 159, 156, 152, 147, 145, 143, 139, 139, 138, 135, 135, 134, 133, 133, 131, 130, 131, 129, 129, 128, 128, 129, 129, 129 },
+      158.500f, 16.946f, 3180.000f, 114.808f, 69.401f, 1.0000f },
+    // neutron, rise tau 18 us, decay tau 80 us
+    { GOLDEN_NEUTRON, 120.0f,
+      { 120, 121, 139, 159, 167, 171, 168, 166, 161, 158, 154, 151, 146, 145, 141, 139, 135, 135, 134, 130, 131, 128, 128, 126, 126, 124, 125, 124, 123, 123 },
+      194.500f, 26.347f, 5965.000f, 126.759f, 85.620f, 1.0000f },
+    // neutron, rise tau 16 us, decay tau 50 us
+    { GOLDEN_NEUTRON, 131.0f,
+      { 131, 130, 140, 150, 154, 152, 149, 147, 145, 142, 141, 138, 137, 137, 134, 134, 134, 133, 132, 133, 133, 131, 133, 132, 133, 131, 130, 131, 130, 132 },
+      127.000f, 20.950f, 1785.000f, 110.780f, 56.363f, 1.0000f },
+    // neutron, decay tau 100 us, tail longer than the window (known miss)
+    { GOLDEN_NEUTRON, 126.0f,
+      { 127, 125, 155, 186, 197, 200, 197, 193, 188, 183, 176, 172, 167, 164, 160, 158, 154, 151, 149, 146, 145, 144, 141, 141, 140, 136, 136, 135, 135, 134 },
+      -1.000f, 23.200f, 9505.000f, 127.733f, 104.664f, 0.9820f },
+    // gamma, rise tau 1.5 us, decay tau 8 us
+    { GOLDEN_GAMMA, 128.0f,
+      { 128, 129, 159, 138, 131, 129, 129, 129, 127, 129, 127, 129, 129, 128, 127, 129, 129, 127, 128, 128, 127, 129, 127, 128, 127, 127, 128, 128, 128, 128 },
+      19.857f, 8.267f, 460.000f, 66.776f, 8.670f, 0.0052f },
+    // gamma, rise tau 1 us, decay tau 6 us
+    { GOLDEN_GAMMA, 122.0f,
+      { 122, 121, 161, 128, 122, 121, 121, 122, 122, 122, 121, 121, 121, 122, 123, 122, 122, 121, 123, 121, 121, 123, 122, 123, 122, 123, 123, 123, 123, 121 },
+      13.500f, 7.800f, 435.000f, 59.856f, -1.000f, 0.0003f },
+    // gamma, rise tau 2 us, decay tau 10 us
+    { GOLDEN_GAMMA, 130.0f,
+      { 129, 131, 152, 138, 134, 131, 129, 131, 131, 130, 131, 129, 131, 130, 130, 130, 130, 131, 129, 130, 131, 131, 129, 131, 130, 131, 130, 131, 130, 130 },
+      26.000f, 8.381f, 415.000f, 66.528f, 11.195f, 0.0953f },
+    // gamma, rise tau 1.5 us, decay tau 7 us
+    { GOLDEN_GAMMA, 125.0f,
+      { 125, 125, 175, 138, 128, 127, 124, 125, 124, 124, 126, 125, 126, 124, 124, 124, 126, 126, 125, 126, 125, 125, 125, 124, 124, 125, 125, 126, 124, 126 },
+      18.000f, 8.000f, 655.000f, 64.320f, 8.089f, 0.0953f }
+};
+
+const uint8_t GOLDEN_CORPUS_SIZE = sizeof(GOLDEN_CORPUS) / sizeof(GOLDEN_CORPUS[0]);
@@ -0,0 +1,34 @@
+#ifndef GOLDEN_CORPUS_H
+#define GOLDEN_CORPUS_H
+
+#include <Arduino.h>
+
+/// Bump whenever a waveform is added or the expected values are regenerated after an intended analysis change
+static constexpr uint16_t GOLDEN_CORPUS_VERSION = 1;
+
+static constexpr uint8_t GOLDEN_SAMPLES = 30;
+static constexpr uint16_t GOLDEN_SAMPLE_INTERVAL_US = 10;
+
+static constexpr uint8_t GOLDEN_GAMMA = 0;
+static constexpr uint8_t GOLDEN_NEUTRON = 1;
+
+/**
+ * @brief Labelled reference waveform with the features the analysis produced for it. \struct GoldenWaveform
+ */
+struct GoldenWaveform
+{
+    uint8_t label;              // true class, GOLDEN_GAMMA or GOLDEN_NEUTRON
+    float baseline;             // in 8-bit sample units
+    uint8_t samples[GOLDEN_SAMPLES];    // taken every GOLDEN_SAMPLE_INTERVAL_US
+    float decayTime;
+    float riseTime;
+    float pulseArea;
+    float zeroCrossingTime;
+    float decayConstant;
+    float neutronProbability;   // with the default classifier tables and prior
+};
+
+extern const GoldenWaveform GOLDEN_CORPUS[] PROGMEM;
+extern const uint8_t GOLDEN_CORPUS_SIZE;
+
+#endif // GOLDEN_CORPUS_H
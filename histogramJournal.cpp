@@ -0,0 +1,286 @@
+#include "histogramJournal.h"
+
+int8_t HistogramJournal::addRegion(uint32_t* bins, uint16_t count, uint32_t tag)
+{
+    if (_regionCount >= MAX_REGIONS || count > MAX_BINS) return -1;
+
+    _regions[_regionCount] = { bins, count, tag };
+    return _regionCount++;
+}
+
+bool HistogramJournal::retag(uint8_t region, uint32_t tag)
+{
+    if (region >= _regionCount || _regions[region].tag == tag) return false;
+
+    // the stored buckets mean something else now, the new snapshot also ends the old journal
+    _regions[region].tag = tag;
+    memset(_regions[region].bins, 0, _regions[region].count * sizeof(uint32_t));
+    compact();
+    return true;
+}
+
+bool HistogramJournal::begin()
+{
+    _mounted = LittleFS.begin();
+    if (!_mounted)
+    {
+        Serial.println("[WARN] HistogramJournal: LittleFS mount failed, checkpoints disabled");
+    }
+    return _mounted;
+}
+
+bool HistogramJournal::restore()
+{
+    if (!_mounted) return false;
+
+    uint32_t start = micros();
+    uint32_t applied = 0;
+    const uint8_t allRegions = (1 << _regionCount) - 1;
+    bool rewrite = false;
+    FileHeader header;
+
+    // a compaction that did not reach its rename, the old base and journal are still complete
+    if (LittleFS.exists(BASE_TMP_PATH)) LittleFS.remove(BASE_TMP_PATH);
+
+    _generation = 0;
+    if (LittleFS.exists(BASE_PATH))
+    {
+        File base = LittleFS.open(BASE_PATH, "r");
+        if (readHeader(base, header))
+        {
+            _generation = header.generation;
+            applied += replay(base, BASE_MAGIC);
+        }
+        rewrite = _validRegions != allRegions;
+        base.close();
+    }
+
+    if (LittleFS.exists(JOURNAL_PATH))
+    {
+        File journal = LittleFS.open(JOURNAL_PATH, "r");
+        if (readHeader(journal, header) && header.generation == _generation)
+        {
+            _journalSize = journal.size();
+            applied += replay(journal, JOURNAL_MAGIC);
+            rewrite = rewrite || _validRegions != allRegions;
+        }
+        else
+        {
+            rewrite = true;     // left over from before the last compaction, or another layout
+        }
+        journal.close();
+    }
+
+    // restored values are on flash already
+    memset(_dirty, 0, sizeof(_dirty));
+    _anyDirty = false;
+
+    if (rewrite)
+    {
+        Serial.println("[WARN] HistogramJournal: stored layout differs, discarded the mismatching histograms");
+        compact();
+    }
+
+    _restoreTimeUs = micros() - start;
+    Serial.printf("[INFO] HistogramJournal: restored %u batches in %u us\n", applied, _restoreTimeUs);
+    return applied > 0;
+}
+
+bool HistogramJournal::checkpoint()
+{
+    if (!_mounted || !_anyDirty) return false;
+
+    if (_journalSize >= JOURNAL_MAX_BYTES) return compact();
+
+    File journal = LittleFS.open(JOURNAL_PATH, "a");
+    if (!journal) return false;
+
+    bool ok = true;
+    if (_journalSize == 0)
+    {
+        FileHeader header;
+        makeHeader(header, _generation);
+        _journalSize = journal.write((const uint8_t*)&header, sizeof(header));
+        ok = _journalSize == sizeof(header);
+    }
+
+    // records are staged in small chunks, each chunk is a self-contained batch
+    static constexpr uint16_t CHUNK = 32;
+    Record* records = _records;
+    uint16_t n = 0;
+
+    auto flush = [&]()
+    {
+        BatchHeader header = { JOURNAL_MAGIC, n, checksum(records, n) };
+        size_t written = journal.write((const uint8_t*)&header, sizeof(header));
+        written += journal.write((const uint8_t*)records, n * sizeof(Record));
+        ok = ok && written == sizeof(header) + n * sizeof(Record);
+        _journalSize += written;
+        n = 0;
+    };
+
+    for (uint8_t r = 0; r < _regionCount; r++)
+    {
+        for (uint8_t w = 0; w < MAX_BINS / 32; w++)
+        {
+            uint32_t word = _dirty[r][w];
+            while (word)
+            {
+                uint8_t bit = __builtin_ctz(word);
+                word &= word - 1;
+
+                uint16_t bin = w * 32 + bit;
+                records[n++] = { r, 0, bin, _regions[r].bins[bin] };
+                if (n == CHUNK) flush();
+            }
+            _dirty[r][w] = 0;
+        }
+    }
+    if (n > 0) flush();
+
+    journal.close();
+    _anyDirty = false;
+    _checkpointCount++;
+    return ok;
+}
+
+bool HistogramJournal::compact()
+{
+    if (!_mounted) return false;
+
+    File base = LittleFS.open(BASE_TMP_PATH, "w");
+    if (!base) return false;
+
+    FileHeader fileHeader;
+    makeHeader(fileHeader, _generation + 1);
+    bool ok = base.write((const uint8_t*)&fileHeader, sizeof(fileHeader)) == sizeof(fileHeader);
+
+    Record* records = _records;
+    for (uint8_t r = 0; r < _regionCount; r++)
+    {
+        uint16_t n = _regions[r].count;
+        for (uint16_t i = 0; i < n; i++)
+        {
+            records[i] = { r, 0, i, _regions[r].bins[i] };
+        }
+
+        BatchHeader header = { BASE_MAGIC, n, checksum(records, n) };
+        size_t written = base.write((const uint8_t*)&header, sizeof(header));
+        written += base.write((const uint8_t*)records, n * sizeof(Record));
+        ok = ok && written == sizeof(header) + n * sizeof(Record);
+    }
+    base.close();
+
+    if (!ok)
+    {
+        LittleFS.remove(BASE_TMP_PATH);
+        return false;
+    }
+
+    // the rename replaces the old base atomically and is the commit point, a journal left behind by a
+    // power loss right after it has the old generation and is ignored by restore()
+    if (!LittleFS.rename(BASE_TMP_PATH, BASE_PATH))
+    {
+        LittleFS.remove(BASE_TMP_PATH);
+        return false;
+    }
+    _generation++;
+    LittleFS.remove(JOURNAL_PATH);
+    _journalSize = 0;
+
+    memset(_dirty, 0, sizeof(_dirty));
+    _anyDirty = false;
+    _checkpointCount++;
+    return true;
+}
+
+uint32_t HistogramJournal::getRestoreTime() const
+{
+    return _restoreTimeUs;
+}
+
+uint32_t HistogramJournal::getCheckpointCount() const
+{
+    return _checkpointCount;
+}
+
+uint32_t HistogramJournal::getJournalSize() const
+{
+    return _journalSize;
+}
+
+uint16_t HistogramJournal::checksum(const Record* records, uint16_t count)
+{
+    const uint8_t* bytes = (const uint8_t*)records;
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+
+    // Fletcher-16
+    for (size_t i = 0; i < count * sizeof(Record); i++)
+    {
+        sum1 = (sum1 + bytes[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+void HistogramJournal::makeHeader(FileHeader& header, uint32_t generation) const
+{
+    memset(&header, 0, sizeof(header));
+    header.magic = FILE_MAGIC;
+    header.version = FORMAT_VERSION;
+    header.regionCount = _regionCount;
+    header.generation = generation;
+    for (uint8_t r = 0; r < _regionCount; r++)
+    {
+        header.regions[r] = { _regions[r].count, 0, _regions[r].tag };
+    }
+}
+
+bool HistogramJournal::readHeader(File& file, FileHeader& header)
+{
+    _validRegions = 0;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) return false;
+    if (header.magic != FILE_MAGIC || header.version != FORMAT_VERSION) return false;
+
+    for (uint8_t r = 0; r < _regionCount && r < header.regionCount; r++)
+    {
+        if (header.regions[r].count == _regions[r].count && header.regions[r].tag == _regions[r].tag)
+        {
+            _validRegions |= 1 << r;
+        }
+    }
+    return true;
+}
+
+uint32_t HistogramJournal::replay(File& file, uint32_t magic)
+{
+    uint32_t applied = 0;
+    Record* records = _records;
+    BatchHeader header;
+
+    while (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header))
+    {
+        if (header.magic != magic || header.count > MAX_BINS) break;
+
+        size_t length = header.count * sizeof(Record);
+        if (file.read((uint8_t*)records, length) != length) break;  // torn write at power loss
+        if (checksum(records, header.count) != header.checksum) break;
+
+        for (uint16_t i = 0; i < header.count; i++)
+        {
+            apply(records[i]);
+        }
+        applied++;
+    }
+
+    return applied;
+}
+
+void HistogramJournal::apply(const Record& record)
+{
+    if (record.region >= _regionCount || !(_validRegions & (1 << record.region))) return;
+    if (record.bin >= _regions[record.region].count) return;
+
+    _regions[record.region].bins[record.bin] = record.value;
+}
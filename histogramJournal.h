@@ -0,0 +1,188 @@
+#ifndef HISTOGRAM_JOURNAL_H
+#define HISTOGRAM_JOURNAL_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+/// @brief Incremental LittleFS checkpointing of in-RAM histograms with dirty-bucket tracking. \class HistogramJournal
+class HistogramJournal
+{
+public:
+
+    static constexpr uint8_t MAX_REGIONS = 4;
+    static constexpr uint16_t MAX_BINS = 128;
+    static constexpr uint32_t JOURNAL_MAX_BYTES = 8192;
+    static constexpr uint16_t FORMAT_VERSION = 2;
+
+    /**
+     * @brief Register a histogram to checkpoint, must happen before restore().
+     * @param bins The histogram buckets.
+     * @param count The number of buckets, at most MAX_BINS.
+     * @param tag What the buckets mean, e.g. a bin width; stored buckets with another count or tag are discarded.
+     * @return int8_t The region id passed to markDirty(), or -1 if no region is left.
+     */
+    int8_t addRegion(uint32_t* bins, uint16_t count, uint32_t tag = 0);
+
+    /**
+     * @brief Change the meaning of a region after restore(), clears it and rewrites the snapshot.
+     * @param region The region id returned by addRegion().
+     * @param tag The new tag.
+     * @return true if the tag changed, false if it was already set.
+     */
+    bool retag(uint8_t region, uint32_t tag);
+
+    /**
+     * @brief Mark a bucket as changed since the last checkpoint.
+     * @param region The region id returned by addRegion().
+     * @param bin The index of the bucket.
+     */
+    inline void markDirty(uint8_t region, uint16_t bin)
+    {
+        _dirty[region][bin >> 5] |= 1UL << (bin & 31);
+        _anyDirty = true;
+    }
+
+    /**
+     * @brief Mount the filesystem.
+     * @return true if the filesystem is usable, false otherwise.
+     */
+    bool begin();
+
+    /**
+     * @brief Rebuild the registered histograms from the base snapshot and the journal.
+     * @return true if a checkpoint was restored, false if none was found.
+     */
+    bool restore();
+
+    /**
+     * @brief Append the dirty buckets to the journal, compacting it once it grows too large.
+     * @return true if the checkpoint was written, false otherwise.
+     */
+    bool checkpoint();
+
+    /**
+     * @brief Write all registered histograms to a new base snapshot and drop the journal.
+     * @return true if the snapshot was written, false otherwise.
+     */
+    bool compact();
+
+    /**
+     * @brief Get the time the last restore took.
+     * @return uint32_t The restore time in microseconds.
+     */
+    uint32_t getRestoreTime() const;
+
+    /**
+     * @brief Get the number of checkpoints written since boot.
+     * @return uint32_t The checkpoint count.
+     */
+    uint32_t getCheckpointCount() const;
+
+    /**
+     * @brief Get the current size of the journal file.
+     * @return uint32_t The journal size in bytes.
+     */
+    uint32_t getJournalSize() const;
+
+private:
+    struct Region
+    {
+        uint32_t* bins;
+        uint16_t count;
+        uint32_t tag;
+    };
+
+    /// @brief One changed bucket, the absolute value makes replay idempotent. \struct Record
+    struct Record
+    {
+        uint8_t region;
+        uint8_t reserved;
+        uint16_t bin;
+        uint32_t value;
+    };
+
+    /// @brief Layout of one region as stored in a file header. \struct RegionLayout
+    struct RegionLayout
+    {
+        uint16_t count;
+        uint16_t reserved;
+        uint32_t tag;
+    };
+
+    /// @brief Header at the start of the base snapshot and the journal. \struct FileHeader
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint8_t regionCount;
+        uint8_t reserved;
+        uint32_t generation;    // a journal only applies on top of the base of the same generation
+        RegionLayout regions[MAX_REGIONS];
+    };
+
+    /// @brief Header in front of every checkpoint batch and the base snapshot. \struct BatchHeader
+    struct BatchHeader
+    {
+        uint32_t magic;
+        uint16_t count;
+        uint16_t checksum;
+    };
+
+    static constexpr uint32_t JOURNAL_MAGIC = 0x4C4E4A48;   // "HJNL"
+    static constexpr uint32_t BASE_MAGIC = 0x53414248;      // "HBAS"
+    static constexpr uint32_t FILE_MAGIC = 0x46414848;      // "HHAF"
+    static constexpr const char* BASE_PATH = "/hist.base";
+    static constexpr const char* BASE_TMP_PATH = "/hist.tmp";
+    static constexpr const char* JOURNAL_PATH = "/hist.jnl";
+
+    Region _regions[MAX_REGIONS];
+    uint32_t _dirty[MAX_REGIONS][MAX_BINS / 32] = {};
+    Record _records[MAX_BINS];    // one staging buffer for all file access, too large for the stack
+    uint8_t _regionCount = 0;
+    uint8_t _validRegions = 0;    // bit mask of the regions whose stored layout matches, set while replaying
+    bool _anyDirty = false;
+    bool _mounted = false;
+    uint32_t _generation = 0;
+    uint32_t _journalSize = 0;
+    uint32_t _restoreTimeUs = 0;
+    uint32_t _checkpointCount = 0;
+
+    /**
+     * @brief Compute the checksum of a record batch.
+     * @param records The records.
+     * @param count The number of records.
+     * @return uint16_t The checksum.
+     */
+    static uint16_t checksum(const Record* records, uint16_t count);
+
+    /**
+     * @brief Fill a file header with the current region layout.
+     * @param header The header to fill.
+     * @param generation The generation to store.
+     */
+    void makeHeader(FileHeader& header, uint32_t generation) const;
+
+    /**
+     * @brief Read a file header and work out which regions of the file are still valid.
+     * @param file The file to read from.
+     * @param header The header read.
+     * @return true if the header belongs to this format version, false otherwise.
+     */
+    bool readHeader(File& file, FileHeader& header);
+
+    /**
+     * @brief Read batches from a file and apply the complete, valid ones.
+     * @param file The file to replay.
+     * @param magic The expected batch magic.
+     * @return uint32_t The number of batches applied.
+     */
+    uint32_t replay(File& file, uint32_t magic);
+
+    /**
+     * @brief Apply a single record to its histogram.
+     * @param record The record to apply.
+     */
+    void apply(const Record& record);
+};
+
+#endif // HISTOGRAM_JOURNAL_H
@@ -0,0 +1,218 @@
+#include "jsonWriter.h"
+
+const char JsonWriter::DIGIT_PAIRS[201] PROGMEM =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+const uint32_t JsonWriter::SCALES[MAX_DECIMALS + 1] PROGMEM = { 1, 10, 100, 1000, 10000 };
+
+JsonWriter::JsonWriter(char* buffer, size_t size, String* spill)
+    : _buffer(buffer)
+    , _size(size)
+    , _spill(spill)
+{
+}
+
+bool JsonWriter::reserve(size_t n)
+{
+    if (_overflow) return false;
+    if (_length + n <= _size) return true;
+
+    if (_spill && n <= _size)
+    {
+        _spill->concat(_buffer, _length);
+        _spilled += _length;
+        _length = 0;
+        return true;
+    }
+
+    _overflow = true;
+    return false;
+}
+
+void JsonWriter::write(const char* data, size_t n)
+{
+    if (!reserve(n)) return;
+    memcpy(_buffer + _length, data, n);
+    _length += n;
+}
+
+void JsonWriter::key(PGM_P fragment)
+{
+    size_t n = strlen_P(fragment);
+    if (!reserve(n)) return;
+    memcpy_P(_buffer + _length, fragment, n);
+    _length += n;
+}
+
+void JsonWriter::raw(char c)
+{
+    if (!reserve(1)) return;
+    _buffer[_length++] = c;
+}
+
+char* JsonWriter::formatDigits(uint32_t value, char* end, uint8_t minDigits)
+{
+    char* p = end;
+
+    // two digits per division, the table is in flash and read a pair at a time
+    while (value >= 100)
+    {
+        p -= 2;
+        memcpy_P(p, &DIGIT_PAIRS[(value % 100) * 2], 2);
+        value /= 100;
+    }
+    if (value >= 10)
+    {
+        p -= 2;
+        memcpy_P(p, &DIGIT_PAIRS[value * 2], 2);
+    }
+    else
+    {
+        *--p = '0' + value;
+    }
+
+    while (end - p < minDigits) *--p = '0';
+    return p;
+}
+
+char* JsonWriter::formatDigits64(uint64_t value, char* end)
+{
+    if ((value >> 32) == 0) return formatDigits(value, end, 1);
+
+    // 64-bit divisions are slow here, split once into a high part and 9 low digits
+    char* p = formatDigits(value % 1000000000, end, 9);
+    uint64_t high = value / 1000000000;
+    if ((high >> 32) == 0) return formatDigits(high, p, 1);
+
+    p = formatDigits(high % 1000000000, p, 9);
+    return formatDigits(high / 1000000000, p, 1);
+}
+
+void JsonWriter::number(uint32_t value)
+{
+    char scratch[10];
+    char* end = scratch + sizeof(scratch);
+    char* p = formatDigits(value, end, 1);
+    write(p, end - p);
+}
+
+void JsonWriter::number64(uint64_t value)
+{
+    char scratch[20];
+    char* end = scratch + sizeof(scratch);
+    char* p = formatDigits64(value, end);
+    write(p, end - p);
+}
+
+void JsonWriter::fixed(float value, uint8_t decimals)
+{
+    // 2^64, the largest float below it still converts to uint64_t
+    if (!isfinite(value) || fabsf(value) >= 18446744073709551616.0f)
+    {
+        key(PSTR("null"));
+        return;
+    }
+
+    if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+    float magnitude = fabsf(value);
+
+    // the integer part and the rest are exact in float, only the rest gets scaled, so a large value
+    // does not round its fraction at the precision of the whole number
+    uint64_t integer = magnitude;
+    float rest = magnitude - (float)integer;
+    writeFixed(value < 0, integer, lroundf(rest * pgm_read_dword(&SCALES[decimals])), decimals);
+}
+
+void JsonWriter::fixed(double value, uint8_t decimals)
+{
+    if (!isfinite(value) || fabs(value) >= 18446744073709551616.0)
+    {
+        key(PSTR("null"));
+        return;
+    }
+
+    if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+    double magnitude = fabs(value);
+    uint64_t integer = magnitude;
+    double rest = magnitude - (double)integer;
+    writeFixed(value < 0, integer, lround(rest * pgm_read_dword(&SCALES[decimals])), decimals);
+}
+
+void JsonWriter::writeFixed(bool negative, uint64_t integer, uint32_t fraction, uint8_t decimals)
+{
+    uint32_t scale = pgm_read_dword(&SCALES[decimals]);
+    if (fraction >= scale)
+    {
+        integer++;
+        fraction -= scale;
+    }
+
+    // drop trailing zeros like the ArduinoJson float output
+    while (decimals > 0 && fraction % 10 == 0)
+    {
+        fraction /= 10;
+        decimals--;
+    }
+
+    char scratch[1 + 20 + 1 + MAX_DECIMALS];
+    char* end = scratch + sizeof(scratch);
+    char* p = end;
+    if (decimals > 0)
+    {
+        p = formatDigits(fraction, p, decimals);
+        *--p = '.';
+    }
+    p = formatDigits64(integer, p);
+    if (negative && (integer != 0 || decimals > 0)) *--p = '-';
+    write(p, end - p);
+}
+
+void JsonWriter::boolean(bool value)
+{
+    if (value) key(PSTR("true"));
+    else key(PSTR("false"));
+}
+
+void JsonWriter::array(const uint8_t* values, uint8_t count)
+{
+    raw('[');
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (i > 0) raw(',');
+        number(values[i]);
+    }
+    raw(']');
+}
+
+void JsonWriter::array(const uint16_t* values, uint8_t count)
+{
+    raw('[');
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (i > 0) raw(',');
+        number(values[i]);
+    }
+    raw(']');
+}
+
+size_t JsonWriter::finish()
+{
+    if (_overflow) return 0;
+
+    size_t total = _spilled + _length;
+    if (_spill)
+    {
+        _spill->concat(_buffer, _length);
+        _length = 0;
+    }
+    return total;
+}
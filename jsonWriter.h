@@ -0,0 +1,137 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+/// @brief Fixed-layout JSON encoder writing straight into a caller buffer. \class JsonWriter
+class JsonWriter
+{
+public:
+
+    static constexpr uint8_t MAX_DECIMALS = 4;
+
+    /**
+     * @brief Construct a writer over a buffer.
+     * @param buffer The output buffer.
+     * @param size The size of the buffer in bytes.
+     * @param spill Receives the buffer contents whenever it fills up, nullptr to fail on overflow instead.
+     */
+    JsonWriter(char* buffer, size_t size, String* spill = nullptr);
+
+    /**
+     * @brief Write a precomputed fragment such as ",\"name\":" from flash.
+     * @param fragment The fragment, a PSTR() literal.
+     */
+    void key(PGM_P fragment);
+
+    /**
+     * @brief Write a single structural character.
+     * @param c The character, e.g. '}' or ','.
+     */
+    void raw(char c);
+
+    /**
+     * @brief Write an unsigned integer.
+     * @param value The value.
+     */
+    void number(uint32_t value);
+
+    /**
+     * @brief Write a 64-bit unsigned integer.
+     * @param value The value.
+     */
+    void number64(uint64_t value);
+
+    /**
+     * @brief Write a float as fixed point with trailing zeros removed, null if not finite or beyond 64 bits.
+     * @param value The value.
+     * @param decimals The number of decimals kept, at most MAX_DECIMALS.
+     */
+    void fixed(float value, uint8_t decimals);
+
+    /**
+     * @brief Write a double as fixed point with trailing zeros removed, null if not finite or beyond 64 bits.
+     * @param value The value, e.g. a count above the 24 bits a float holds exactly.
+     * @param decimals The number of decimals kept, at most MAX_DECIMALS.
+     */
+    void fixed(double value, uint8_t decimals);
+
+    /**
+     * @brief Write true or false.
+     * @param value The value.
+     */
+    void boolean(bool value);
+
+    /**
+     * @brief Write a comma separated array of 8-bit values.
+     * @param values The values.
+     * @param count The number of values.
+     */
+    void array(const uint8_t* values, uint8_t count);
+
+    /**
+     * @brief Write a comma separated array of 16-bit values.
+     * @param values The values.
+     * @param count The number of values.
+     */
+    void array(const uint16_t* values, uint8_t count);
+
+    /**
+     * @brief Complete the output, moving what is left to the spill string if there is one.
+     * @return size_t The total output length, 0 if the buffer overflowed.
+     */
+    size_t finish();
+
+private:
+    char* _buffer;
+    size_t _size;
+    size_t _length = 0;
+    size_t _spilled = 0;
+    String* _spill;
+    bool _overflow = false;
+
+    static const char DIGIT_PAIRS[201] PROGMEM;
+    static const uint32_t SCALES[MAX_DECIMALS + 1] PROGMEM;
+
+    /**
+     * @brief Make room for a number of bytes, spilling the buffer if needed.
+     * @param n The number of bytes about to be written.
+     * @return true if they fit.
+     */
+    bool reserve(size_t n);
+
+    /**
+     * @brief Format the decimal digits of a value backwards from the end of a scratch buffer.
+     * @param value The value.
+     * @param end One past the last digit.
+     * @param minDigits Zero padding, the minimum number of digits written.
+     * @return char* The first digit.
+     */
+    static char* formatDigits(uint32_t value, char* end, uint8_t minDigits);
+
+    /**
+     * @brief Format a 64-bit value backwards like formatDigits(), with at most two 64-bit divisions.
+     * @param value The value.
+     * @param end One past the last digit.
+     * @return char* The first digit.
+     */
+    static char* formatDigits64(uint64_t value, char* end);
+
+    /**
+     * @brief Write a value split into its integer part and its fraction, both already exact.
+     * @param negative true for a value below zero, a value rounding to zero is written without the sign.
+     * @param integer The integer part of the magnitude.
+     * @param fraction The fraction of the magnitude in units of 10^-decimals, may round up to a whole unit.
+     * @param decimals The number of decimals of fraction.
+     */
+    void writeFixed(bool negative, uint64_t integer, uint32_t fraction, uint8_t decimals);
+
+    /**
+     * @brief Copy formatted bytes to the output.
+     * @param data The bytes.
+     * @param n The number of bytes.
+     */
+    void write(const char* data, size_t n);
+};
+
+#endif // JSON_WRITER_H
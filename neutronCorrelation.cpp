@@ -0,0 +1,135 @@
+#include "neutronCorrelation.h"
+
+void NeutronCorrelation::setDeadTime(uint32_t deadTimeUs)
+{
+    _deadTimeUs = deadTimeUs;
+
+    // a Rossi-alpha range of 8 dead times, R+A right behind the dead time, A far behind it; at most one
+    // event per dead time, so the long delay plus gate window of 20 dead times (40 ms at 2 ms) never holds
+    // more than RING_SIZE events
+    _rossiBinUs = max(deadTimeUs / DEAD_TIME_BINS, DEFAULT_ROSSI_BIN_US);
+    _predelayUs = max(deadTimeUs, DEFAULT_PREDELAY_US);
+    _gateUs = max(4 * deadTimeUs, DEFAULT_GATE_US);
+    _longDelayUs = max(16 * deadTimeUs, DEFAULT_LONG_DELAY_US);
+    reset();
+}
+
+bool NeutronCorrelation::configure(uint32_t rossiBinUs, uint32_t predelayUs, uint32_t gateUs, uint32_t longDelayUs)
+{
+    rossiBinUs = rossiBinUs > 0 ? rossiBinUs : max(_deadTimeUs / DEAD_TIME_BINS, DEFAULT_ROSSI_BIN_US);
+    gateUs = gateUs > 0 ? gateUs : max(4 * _deadTimeUs, DEFAULT_GATE_US);
+
+    // inside the dead time every histogram bin and gate counts zero by construction
+    if (rossiBinUs * ROSSI_BINS <= _deadTimeUs || predelayUs < _deadTimeUs || gateUs < _deadTimeUs) return false;
+
+    _rossiBinUs = rossiBinUs;
+    _predelayUs = predelayUs;
+    _gateUs = gateUs;
+    _longDelayUs = max(longDelayUs, _predelayUs + _gateUs);
+    reset();
+    return true;
+}
+
+void NeutronCorrelation::reset()
+{
+    _head = 0;
+    _count = 0;
+    _singles = 0;
+    _ringOverflows = 0;
+    memset(_rossi, 0, sizeof(_rossi));
+    memset(_realsPlusAccidentals, 0, sizeof(_realsPlusAccidentals));
+    memset(_accidentals, 0, sizeof(_accidentals));
+}
+
+void NeutronCorrelation::addEvent(uint64_t timestamp)
+{
+    const uint32_t maxWindow = window();
+
+    // drop events that no gate can reach any more, each event leaves once so this is O(1) amortised
+    while (_count > 0)
+    {
+        uint8_t oldest = (_head + RING_SIZE - _count) % RING_SIZE;
+        if (timestamp - _times[oldest] < maxWindow) break;
+        _count--;
+    }
+
+    // backward-looking gates on the history are equivalent to forward gates opened by each trigger
+    uint8_t ra = 0;
+    uint8_t a = 0;
+    const uint32_t rossiWindow = _rossiBinUs * ROSSI_BINS;
+
+    for (uint8_t k = 1; k <= _count; ++k)
+    {
+        uint64_t dt = timestamp - _times[(_head + RING_SIZE - k) % RING_SIZE];
+
+        if (dt < rossiWindow) _rossi[dt / _rossiBinUs]++;
+        if (dt >= _predelayUs && dt < _predelayUs + _gateUs) ra++;
+        if (dt >= _longDelayUs && dt < _longDelayUs + _gateUs) a++;
+    }
+
+    _realsPlusAccidentals[min(ra, (uint8_t)(MULTIPLICITY_MAX - 1))]++;
+    _accidentals[min(a, (uint8_t)(MULTIPLICITY_MAX - 1))]++;
+    _singles++;
+
+    if (_count == RING_SIZE)
+    {
+        // the oldest event is still inside a window, later gates will miss it
+        _ringOverflows++;
+        _count--;
+    }
+    _times[_head] = timestamp;
+    _head = (_head + 1) % RING_SIZE;
+    _count++;
+}
+
+void NeutronCorrelation::toJSON(JsonDocument& doc) const
+{
+    doc["dead_time_us"] = _deadTimeUs;
+    doc["rossi_bin_us"] = _rossiBinUs;
+    doc["predelay_us"] = _predelayUs;
+    doc["gate_us"] = _gateUs;
+    doc["long_delay_us"] = _longDelayUs;
+    doc["singles"] = _singles;
+    doc["ring_overflows"] = _ringOverflows;
+
+    JsonArray rossi = doc.createNestedArray("rossi_alpha");
+    for (uint8_t i = 0; i < ROSSI_BINS; i++)
+    {
+        rossi.add(_rossi[i]);
+    }
+
+    JsonArray ra = doc.createNestedArray("reals_plus_accidentals");
+    JsonArray a = doc.createNestedArray("accidentals");
+    for (uint8_t i = 0; i < MULTIPLICITY_MAX; i++)
+    {
+        ra.add(_realsPlusAccidentals[i]);
+        a.add(_accidentals[i]);
+    }
+
+    float raM1, raM2, aM1, aM2;
+    moments(_realsPlusAccidentals, raM1, raM2);
+    moments(_accidentals, aM1, aM2);
+
+    // doubles = (R+A) - A, the gate counts summed over all triggers
+    doc["ra_sum"] = raM1;
+    doc["a_sum"] = aM1;
+    doc["doubles"] = raM1 - aM1;
+    doc["ra_factorial_moment_2"] = raM2;
+    doc["a_factorial_moment_2"] = aM2;
+}
+
+uint32_t NeutronCorrelation::window() const
+{
+    return max(_rossiBinUs * ROSSI_BINS, max(_predelayUs + _gateUs, _longDelayUs + _gateUs));
+}
+
+void NeutronCorrelation::moments(const uint32_t* hist, float& m1, float& m2)
+{
+    m1 = 0;
+    m2 = 0;
+    for (uint8_t n = 1; n < MULTIPLICITY_MAX; n++)
+    {
+        m1 += (float)n * hist[n];
+        m2 += n * (n - 1) / 2.0f * hist[n];
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef NEUTRON_CORRELATION_H
+#define NEUTRON_CORRELATION_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/// @brief Rossi-alpha and shift-register multiplicity analysis of neutron event times. \class NeutronCorrelation
+class NeutronCorrelation
+{
+public:
+
+    static constexpr uint8_t RING_SIZE = 64;
+    static constexpr uint8_t ROSSI_BINS = 64;
+    static constexpr uint8_t MULTIPLICITY_MAX = 16;
+    static constexpr uint32_t DEFAULT_ROSSI_BIN_US = 4;
+    static constexpr uint32_t DEFAULT_PREDELAY_US = 4;
+    static constexpr uint32_t DEFAULT_GATE_US = 64;
+    static constexpr uint32_t DEFAULT_LONG_DELAY_US = 4096;
+    static constexpr uint8_t DEAD_TIME_BINS = 8;        // Rossi-alpha bins per dead time by default
+
+    /**
+     * @brief Set the dead time of the trigger and derive the default binning and gates from it, clears the results.
+     *
+     * No two events are closer than the dead time, so the predelay and the gates start at it by default.
+     * @param deadTimeUs The shortest interval between two recorded events in microseconds.
+     */
+    void setDeadTime(uint32_t deadTimeUs);
+
+    /**
+     * @brief Configure the Rossi-alpha binning and the shift-register gates, clears the results.
+     * @param rossiBinUs The width of one Rossi-alpha bin in microseconds, 0 for the default.
+     * @param predelayUs The predelay in front of the R+A gate in microseconds, at least the dead time.
+     * @param gateUs The width of the R+A and A gates in microseconds, 0 for the default, at least the dead time.
+     * @param longDelayUs The delay of the A gate in microseconds.
+     * @return false if the Rossi-alpha range or a gate fits inside the dead time, nothing is changed then.
+     */
+    bool configure(uint32_t rossiBinUs, uint32_t predelayUs, uint32_t gateUs, uint32_t longDelayUs);
+
+    /**
+     * @brief Clear the accumulated histograms and the event ring.
+     */
+    void reset();
+
+    /**
+     * @brief Feed a neutron event, events must arrive in time order.
+     * @param timestamp The event time in microseconds.
+     */
+    void addEvent(uint64_t timestamp);
+
+    /**
+     * @brief Add the histograms and multiplicity moments to a JSON document.
+     * @param doc The JSON document to fill.
+     */
+    void toJSON(JsonDocument& doc) const;
+
+private:
+    uint32_t _deadTimeUs = 0;
+    uint32_t _rossiBinUs = DEFAULT_ROSSI_BIN_US;
+    uint32_t _predelayUs = DEFAULT_PREDELAY_US;
+    uint32_t _gateUs = DEFAULT_GATE_US;
+    uint32_t _longDelayUs = DEFAULT_LONG_DELAY_US;
+
+    uint64_t _times[RING_SIZE];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+
+    uint32_t _rossi[ROSSI_BINS] = {};
+    uint32_t _realsPlusAccidentals[MULTIPLICITY_MAX] = {};
+    uint32_t _accidentals[MULTIPLICITY_MAX] = {};
+    uint32_t _singles = 0;
+    uint32_t _ringOverflows = 0;
+
+    /**
+     * @brief Get the longest time difference any result still needs.
+     * @return uint32_t The window in microseconds.
+     */
+    uint32_t window() const;
+
+    /**
+     * @brief Compute the first two factorial moments of a multiplicity distribution.
+     * @param hist The multiplicity distribution.
+     * @param m1 Receives the sum of n * count.
+     * @param m2 Receives the sum of n * (n - 1) / 2 * count.
+     */
+    static void moments(const uint32_t* hist, float& m1, float& m2);
+};
+
+#endif // NEUTRON_CORRELATION_H
@@ -1,29 +1,279 @@
 #include "neutronDetector.h"
 
-NeutronDetector::NeutronDetector(uint8_t analogPin, uint16_t threshold)
+template <typename Policies>
+constexpr typename BasicNeutronDetector<Policies>::Log2Table BasicNeutronDetector<Policies>::LOG2_Q12;
+
+static_assert(GOLDEN_SAMPLES == NeutronDetector::SAMPLES_PER_PULSE, "golden corpus does not match the pulse length");
+
+template <typename Policies>
+BasicNeutronDetector<Policies>::BasicNeutronDetector(uint8_t analogPin, uint16_t threshold)
     : _pin(analogPin)
     , _threshold(threshold)
     , _writeIndex(0)
     , _storedCount(0)
     ,_lastCaptureTime(0)
 {
+    for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
+    {
+        _sampleSchedule[i] = i * SAMPLE_INTERVAL_US;
+    }
+
+    // until a calibration is loaded the soft classifier follows the hard-rule thresholds
+    memset(_classifier, 0, sizeof(_classifier));
+    initClassifierStep(Feature::DECAY_TIME, NEUTRON_DECAY_TIME_THRESHOLD, 5.0f);
+    initClassifierStep(Feature::RISE_TIME, NEUTRON_RISE_TIME_THRESHOLD, 2.0f);
+    initClassifierStep(Feature::PULSE_AREA, NEUTRON_AREA_THRESHOLD, 100.0f);
+
+    _sinks.template apply<NeutronCorrelation>([](NeutronCorrelation& c) { c.setDeadTime(DEAD_TIME_US); });
+    _sinks.template apply<FeynmanAnalysis>([](FeynmanAnalysis& f) { f.setDeadTime(DEAD_TIME_US); });
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::initClassifierStep(Feature feature, float threshold, float binWidth)
+{
+    FeatureTable& t = _classifier[(uint8_t)feature];
+    t.min = threshold - binWidth * CLASSIFIER_BINS / 2;
+    t.binWidth = binWidth;
+
+    for (uint8_t i = 0; i < CLASSIFIER_BINS; ++i)
+    {
+        // 1.5 nats per bin away from the threshold, capped at 4 nats
+        float bins = (t.min + (i + 0.5f) * binWidth - threshold) / binWidth;
+        float llr = max(min(bins * 1.5f, 4.0f), -4.0f);
+        t.llr[i] = llr * 16.0f;
+    }
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::setClassifierTable(Feature feature, const FeatureTable& table)
+{
+    if (feature >= Feature::COUNT || table.binWidth <= 0) return;
+    _classifier[(uint8_t)feature] = table;
+    _classifierCalibrated = true;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::setClassifierPrior(float neutronFraction)
+{
+    if (neutronFraction <= 0 || neutronFraction >= 1) return;
+    _classifierPriorLogit = logf(neutronFraction / (1.0f - neutronFraction));
+    _classifierCalibrated = true;
+}
+
+template <typename Policies>
+float BasicNeutronDetector<Policies>::classify(const PulseAnalysis& a) const
+{
+    const float features[(uint8_t)Feature::COUNT] = {
+        a.decayTime, a.riseTime, a.pulseArea, a.decayConstant, a.zeroCrossingTime
+    };
+
+    // naive Bayes: the per-feature log-likelihood ratios add up to the posterior logit
+    int32_t llrSum = 0;
+    for (uint8_t f = 0; f < (uint8_t)Feature::COUNT; ++f)
+    {
+        const FeatureTable& t = _classifier[f];
+        if (t.binWidth <= 0) continue;
 
+        int32_t bin = (features[f] - t.min) / t.binWidth;
+        if (bin < 0) bin = 0;
+        if (bin >= CLASSIFIER_BINS) bin = CLASSIFIER_BINS - 1;
+        llrSum += t.llr[bin];
+    }
+
+    float logit = _classifierPriorLogit + llrSum / 16.0f;
+    return 1.0f / (1.0f + expf(-logit));
 }
 
-void NeutronDetector::begin()
+template <typename Policies>
+void BasicNeutronDetector<Policies>::begin()
 {    
+    _cyclesPerUs = ESP.getCpuFreqMHz();
+
+    SelfTestResult selfTest = runSelfTest();
+    Serial.printf("[%s] Self-test corpus v%u: %u/%u classified correctly, %u feature mismatches, max %u cycles per pulse\n",
+                  selfTest.passed ? "INFO" : "WARN", GOLDEN_CORPUS_VERSION, selfTest.correct, selfTest.waveforms,
+                  selfTest.featureMismatches, selfTest.maxCycles);
+
+    _spectrumRegion = _journal.addRegion(&_spectrum[0][0], 2 * SPECTRUM_BINS);
+    _tofRegion = _journal.addRegion(&_tofHistogram[0][0], 2 * TOF_BINS, _tofBinCycles / _cyclesPerUs);
+    _timeRegion = _journal.addRegion(&_measuredSeconds, 1);
+    if (_journal.begin()) _journal.restore();
+    _restoredSeconds = _measuredSeconds;
+    _lastCheckpoint = micros64();
+
+    _startTime = micros64();
     _initialized = true;
     Serial.println("[INFO] NeutronDetector initialized with 10-bit ADC resolution");
 }
 
-bool NeutronDetector::isInitialized() const
+template <typename Policies>
+void BasicNeutronDetector<Policies>::enableVeto(uint8_t vetoPin, uint32_t windowUs, bool reject)
+{
+    _vetoPin = vetoPin;
+    _vetoWindowUs = windowUs;
+    _vetoReject = reject;
+    _vetoHead = 0;
+    _vetoTail = 0;
+    _vetoEnabledAt = micros64();
+    _vetoDeadEnd = micros();
+    _vetoEnabled = true;
+
+    pinMode(_vetoPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(_vetoPin), vetoISR, this, RISING);
+    Serial.printf("[INFO] Veto input enabled on pin %u, window %u us\n", _vetoPin, _vetoWindowUs);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::enableStartInput(uint8_t startPin, uint32_t binWidthUs)
+{
+    _cyclesPerUs = ESP.getCpuFreqMHz();
+
+    // the TOF stamp is taken after the trigger read, so the read sets the scale of the histogram
+    uint32_t latencyStart = micros();
+    overSample(true);
+    _triggerLatencyUs = micros() - latencyStart;
+
+    if (binWidthUs == TOF_BIN_AUTO)
+    {
+        // a power of two, so a slightly different latency after a reboot keeps the same bins
+        uint32_t span = max(_triggerLatencyUs, (uint32_t)1) * TOF_SPAN_LATENCIES;
+        binWidthUs = 1;
+        while (binWidthUs * TOF_BINS < span) binWidthUs <<= 1;
+    }
+    binWidthUs = constrain(binWidthUs, (uint32_t)1, TOF_MAX_BIN_US);
+
+    _startPin = startPin;
+    _tofBinCycles = binWidthUs * _cyclesPerUs;
+    _startCount = 0;
+    if (_tofRegion >= 0 && _journal.retag(_tofRegion, binWidthUs)) _tofOverflow = 0;
+    _tofEnabled = true;
+
+    pinMode(_startPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(_startPin), startISR, this, RISING);
+    Serial.printf("[INFO] Start input enabled on pin %u, TOF bin width %u us\n", _startPin, binWidthUs);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::enablePulser(uint32_t periodUs, bool randomIntervals)
+{
+    _pulserPeriodUs = periodUs;
+    _pulserRandom = randomIntervals;
+    _pulserRequested = 0;
+    _pulserRecorded = 0;
+    if (_pulserPeriodUs > 0) _nextPulserTime = micros64() + nextPulserInterval();
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::setSampleSchedule(const uint16_t* offsetsUs)
+{
+    for (uint8_t i = 1; i < SAMPLES_PER_PULSE; ++i)
+    {
+        if (offsetsUs[i] <= offsetsUs[i - 1]) return false;
+    }
+
+    memcpy(_sampleSchedule, offsetsUs, sizeof(_sampleSchedule));
+
+    // a mean interval and a sample rate only mean something when all intervals are equal
+    _uniformSchedule = true;
+    for (uint8_t i = 2; i < SAMPLES_PER_PULSE; ++i)
+    {
+        if (offsetsUs[i] - offsetsUs[i - 1] != offsetsUs[1] - offsetsUs[0]) _uniformSchedule = false;
+    }
+
+    // the statistics of the previous schedule say nothing about this one
+    _sampleIntervalUs = offsetsUs[1] - offsetsUs[0];
+    _sampleJitterUs = 0;
+    return true;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::setGeometricSchedule(uint8_t denseSamples, uint16_t denseIntervalUs, float growth)
+{
+    if (denseIntervalUs == 0 || growth < 1.0f) return false;
+    if (geometricOffset(SAMPLES_PER_PULSE - 1, denseSamples, denseIntervalUs, 1.0f) > UINT16_MAX) return false;
+
+    // the growth is clamped so the last offset still fits the 16-bit schedule
+    if (geometricOffset(SAMPLES_PER_PULSE - 1, denseSamples, denseIntervalUs, growth) > UINT16_MAX)
+    {
+        float low = 1.0f;
+        float high = growth;
+        for (uint8_t i = 0; i < 32; ++i)
+        {
+            float mid = (low + high) / 2;
+            if (geometricOffset(SAMPLES_PER_PULSE - 1, denseSamples, denseIntervalUs, mid) > UINT16_MAX) high = mid;
+            else low = mid;
+        }
+        Serial.printf("[WARN] Schedule growth %.3f clamped to %.3f\n", growth, low);
+        growth = low;
+    }
+
+    uint16_t offsets[SAMPLES_PER_PULSE];
+    for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
+    {
+        offsets[i] = lround(geometricOffset(i, denseSamples, denseIntervalUs, growth));
+        if (i > 0 && offsets[i] <= offsets[i - 1]) offsets[i] = offsets[i - 1] + 1;
+    }
+
+    return setSampleSchedule(offsets);
+}
+
+template <typename Policies>
+double BasicNeutronDetector<Policies>::geometricOffset(uint8_t index, uint8_t denseSamples, uint16_t denseIntervalUs, float growth)
+{
+    double offset = 0;
+    double interval = denseIntervalUs;
+    for (uint8_t i = 0; i < index; ++i)
+    {
+        if (i + 1 >= denseSamples) interval *= growth;
+        offset += interval;
+    }
+    return offset;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::setMisclassification(uint8_t band, float gammaAsNeutron, float neutronAsGamma)
+{
+    if (band >= ENERGY_BANDS) return;
+    if (gammaAsNeutron < 0 || neutronAsGamma < 0 || gammaAsNeutron + neutronAsGamma >= 1.0f) return;
+
+    _gammaAsNeutron[band] = gammaAsNeutron;
+    _neutronAsGamma[band] = neutronAsGamma;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::configureCorrelation(uint32_t rossiBinUs, uint32_t predelayUs, uint32_t gateUs, uint32_t longDelayUs)
+{
+    bool accepted = false;
+    _sinks.template apply<NeutronCorrelation>([&](NeutronCorrelation& c) { accepted = c.configure(rossiBinUs, predelayUs, gateUs, longDelayUs); });
+    if (!accepted) Serial.printf("[WARN] Correlation gates must start and last at least the %u us dead time\n", DEAD_TIME_US);
+    return accepted;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::configureFeynman(uint32_t baseGateUs)
+{
+    bool accepted = false;
+    _sinks.template apply<FeynmanAnalysis>([&](FeynmanAnalysis& f) { accepted = f.configure(baseGateUs); });
+    if (!accepted) Serial.printf("[WARN] Feynman gates must be at least the %u us dead time\n", DEAD_TIME_US);
+    return accepted;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::isInitialized() const
 {
     return _initialized;
 }
 
-void NeutronDetector::update()
+template <typename Policies>
+void BasicNeutronDetector<Policies>::update()
 {
-    uint64_t now = micros();
+    TRACE_SCOPE(TraceStage::ACQUISITION);
+    uint64_t now = micros64();
+
+#if NEUTRON_FAULT_INJECTION
+    // before the connection check, a fault that disconnects the input must still expire
+    updateFault();
+#endif
 
     if (now - _lastConnectionCheck > CONNECTION_CHECK_INTERVAL)
     {
@@ -32,6 +282,7 @@ void NeutronDetector::update()
 
         if (!_inputConnected)
         {
+            _disconnectResets++;
             reset();
             return;
         }
@@ -39,61 +290,379 @@ void NeutronDetector::update()
 
     if (!_inputConnected) return;
 
+    if (now - _lastCheckpoint >= CHECKPOINT_INTERVAL_US)
+    {
+        _measuredSeconds = _restoredSeconds + (now - _startTime) / 1000000;
+        if (_timeRegion >= 0) _journal.markDirty(_timeRegion, 0);
+        _journal.checkpoint();
+        _lastCheckpoint = now;
+    }
+
+    if (_vetoEnabled) processVetoes();
+    if (_tofEnabled) expireStaleStart();
+
     updateBaseline();
+
+    bool live = now - _lastCaptureTime >= DEAD_TIME_US;
+#if NEUTRON_FAULT_INJECTION
+    if (isFaultBlinded(now)) live = false;
+#endif
+
+    if (_pulserPeriodUs > 0 && now >= _nextPulserTime)
+    {
+        // every tick that passed counts as requested, only one can be taken now and only if a trigger could be
+        while (_nextPulserTime <= now)
+        {
+            _pulserRequested++;
+            _nextPulserTime += nextPulserInterval();
+        }
+        if (!live) return;
+        if (capturePulse(true)) _pulserRecorded++;
+        _lastCaptureTime = now;
+        return;
+    }
     
-    if (now - _lastCaptureTime >= _minInterval)
+    if (live)
     {
         uint16_t val = overSample(true);
-        if (val - _baseline >= _threshold)
+        if (_trigger.fires(val, _threshold))
         {
             capturePulse();
             _lastCaptureTime = now;
-            _totalPulses++;
         }
     }
 }
 
-void NeutronDetector::capturePulse()
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::capturePulse(bool forced)
 {
+    uint32_t cycles = ESP.getCycleCount();
+    uint64_t timestamp = micros64();
+
+    bool vetoed = !forced && isVetoed(timestamp);
+    bool counted = !forced && (!vetoed || !_vetoReject);
+    if (vetoed) (_vetoReject ? _vetoRejected : _vetoTagged)++;
+    if (counted) _totalPulses++;
+
+    // a slot being read is never written, the event is dropped instead of waiting
+    if (_leases[_writeIndex] > 0)
+    {
+        _capturesLostToLease++;
+        return false;
+    }
+
+    // the slot holds the oldest pulse once the ring is full, it stops being readable now
+    if (_storedCount == MAX_PULSES) _storedCount--;
+
     Pulse& p = _pulses[_writeIndex];
-    p.timestamp = micros();
+    p.tofCycles = computeTimeOfFlight(cycles);
+    p.timestamp = timestamp;
+    p.serializedAt = 0;
+    p.flags = forced ? PULSE_FLAG_PULSER : (vetoed ? PULSE_FLAG_VETOED : 0);
+    p.baseline = computeLocalBaseline();
+
     uint8_t peak = 0;
-    uint64_t sampleStart = micros();
+    uint32_t sampleStart = micros();  // 32-bit on purpose, the difference below is wrap safe
+    uint32_t firstCycles = 0;
 
     for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
     {
-        while (micros() - sampleStart < i * SAMPLE_INTERVAL_US)
+        while (micros() - sampleStart < _sampleSchedule[i])
         {
 
         }
         
-        uint16_t raw = overSample(true);
-        if (raw >= MAX_RAW_VALUE) return;
+        uint32_t before = ESP.getCycleCount();
+        uint16_t raw = Policies::Capture::sample(*this);
+        uint32_t mid = before + (ESP.getCycleCount() - before) / 2;  // the sample stands for the middle of its reads
+
+        if (i == 0) firstCycles = mid;
+        p.sampleTimes[i] = (mid - firstCycles + _cyclesPerUs / 2) / _cyclesPerUs;
+
+        if (raw >= MAX_RAW_VALUE)
+        {
+            _saturatedCaptures++;
+            return false;
+        }
 
         p.samples[i] = raw >> 2;  // 10-bit to 8-bit (1023/255 = 4)
         if (p.samples[i] > peak) peak = p.samples[i];
     }
 
+    uint64_t captured = micros64();
+    p.captureUs = captured - timestamp > UINT16_MAX ? UINT16_MAX : captured - timestamp;
+    p.analysisUs = 0;
     p.peakValue = peak;
+    updateSampleClock(p);
     _writeIndex = (_writeIndex + 1) % MAX_PULSES;
+    _pulseSeq++;
     _storedCount = (_storedCount + 1) < MAX_PULSES ? (_storedCount + 1) : MAX_PULSES;
 
-    PulseAnalysis analysis = analyzePulse(p);
+    if (forced)
+    {
+        p.neutronProbability = 0;
+        updatePulserSnapshot(p);
+        if (_streamActive) publishLastPulse();
+        return true;
+    }
+
+    TRACE_BEGIN(TraceStage::ANALYSIS);
+    PulseAnalysis analysis = Policies::Analyzer::analyze(*this, p);
+    TRACE_END(TraceStage::ANALYSIS);
+    uint64_t analyzed = micros64() - captured;
+    p.analysisUs = analyzed > UINT16_MAX ? UINT16_MAX : analyzed;
+    p.neutronProbability = analysis.neutronProbability * 255.0f + 0.5f;
+    if (counted)
+    {
+        // the stored Q8 value, so a veto takes back exactly what was added
+        _neutronExpectedQ8 += p.neutronProbability;
+        _neutronClassVarianceQ16 += (uint32_t)p.neutronProbability * (255 - p.neutronProbability);
+    }
     if (analysis.isNeutron)
     {
-        _neutronCount++;
-        _lastNeutronTime = p.timestamp;
+        p.flags |= PULSE_FLAG_NEUTRON;
+        if (counted)
+        {
+            _neutronCount++;
+            _lastNeutronTime = p.timestamp;
+            _sinks.addEvent(p.timestamp);
+        }
     }
+    if (counted) accountHistograms(p, 1);
     if (analysis.pulseArea > _maxPulseArea) _maxPulseArea = analysis.pulseArea;
     if (analysis.decayTime > _maxDecayTime) _maxDecayTime = analysis.decayTime;
+
+    if (_streamActive) publishLastPulse(&analysis);
+    return true;
+}
+
+template <typename Policies>
+uint32_t BasicNeutronDetector<Policies>::nextPulserInterval() const
+{
+    if (!_pulserRandom) return _pulserPeriodUs;
+
+    // exponential intervals give a Poisson pulser, uniform in (0, 1] avoids log(0)
+    float u = random(1, 0x7FFFFFFF) / 2147483647.0f;
+    return (uint32_t)(-logf(u) * _pulserPeriodUs) + 1;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::updatePulserSnapshot(const Pulse& p)
+{
+    float sum = 0;
+    float sumSq = 0;
+    for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
+    {
+        sum += p.samples[i];
+        sumSq += (float)p.samples[i] * p.samples[i];
+    }
+
+    float mean = sum / SAMPLES_PER_PULSE;
+    float rms = sqrtf(max(sumSq / SAMPLES_PER_PULSE - mean * mean, 0.0f));
+
+    // 10-bit ADC units like _baseline and _noiseRMS
+    if (_pulserRecorded == 0)
+    {
+        _pulserBaseline = mean * 4.0f;
+        _pulserNoiseRMS = rms * 4.0f;
+        return;
+    }
+    _pulserBaseline = 0.9f * _pulserBaseline + 0.1f * mean * 4.0f;
+    _pulserNoiseRMS = 0.9f * _pulserNoiseRMS + 0.1f * rms * 4.0f;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::publishLastPulse(const PulseAnalysis* analysis)
+{
+    if (micros64() - _lastStreamRead > STREAM_IDLE_TIMEOUT_US)
+    {
+        _streamActive = false;
+        return;
+    }
+
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    char frame[STREAM_FRAME_MAX];
+    Pulse& p = _pulses[(_writeIndex + MAX_PULSES - 1) % MAX_PULSES];
+    uint64_t serializedAt = 0;
+    size_t length = encodePulse(frame, sizeof(frame), p, WaveformView::RAW, SAMPLES_PER_PULSE, &serializedAt, analysis);
+    p.serializedAt = serializedAt;
+
+    if (length == 0 || !_stream.publish(frame, length))
+    {
+        _streamDropped++;
+    }
+}
+
+template <typename Policies>
+void IRAM_ATTR BasicNeutronDetector<Policies>::vetoISR(void* arg)
+{
+    BasicNeutronDetector* self = static_cast<BasicNeutronDetector*>(arg);
+    uint32_t head = self->_vetoHead;
+    self->_vetoTimes[head & (VETO_RING_SIZE - 1)] = micros();
+    self->_vetoHead = head + 1;
+}
+
+template <typename Policies>
+void IRAM_ATTR BasicNeutronDetector<Policies>::startISR(void* arg)
+{
+    BasicNeutronDetector* self = static_cast<BasicNeutronDetector*>(arg);
+    self->_startCycles = ESP.getCycleCount();
+    self->_startMicros = micros();
+    self->_startCount = self->_startCount + 1;
+}
+
+template <typename Policies>
+uint32_t BasicNeutronDetector<Policies>::computeTimeOfFlight(uint32_t cycles) const
+{
+    if (!_tofEnabled) return TOF_INVALID;
+
+    noInterrupts();
+    uint32_t startCycles = _startCycles;
+    uint32_t startCount = _startCount;
+    interrupts();
+
+    if (startCount == 0) return TOF_INVALID;
+    return cycles - startCycles;  // wrap safe, expireStaleStart() keeps it within one counter period
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::expireStaleStart()
+{
+    noInterrupts();
+    bool stale = _startCount > 0 && micros() - _startMicros > TOF_MAX_START_AGE_US;
+    if (stale) _startCount = 0;
+    interrupts();
+
+    if (stale) _tofStaleStarts++;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::computeBandCounts(uint32_t counts[ENERGY_BANDS][2]) const
+{
+    memset(counts, 0, sizeof(uint32_t) * ENERGY_BANDS * 2);
+
+    // the spectrum is already kept per class and is restored from flash, so bands come from it
+    uint8_t band = 0;
+    for (uint8_t bin = 0; bin < SPECTRUM_BINS; bin++)
+    {
+        while (band < ENERGY_BANDS - 1 && bin * 4 >= _bandEdges[band]) band++;
+        counts[band][0] += _spectrum[0][bin];
+        counts[band][1] += _spectrum[1][bin];
+    }
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::accountHistograms(const Pulse& p, int8_t delta)
+{
+    const uint8_t cls = (p.flags & PULSE_FLAG_NEUTRON) ? 1 : 0;
+
+    float amplitude = p.peakValue - p.baseline;
+    uint8_t heightBin = amplitude > 0 ? (uint8_t)amplitude >> 2 : 0;  // 256 sample levels in 64 bins
+    _spectrum[cls][heightBin] += delta;
+    if (_spectrumRegion >= 0) _journal.markDirty(_spectrumRegion, cls * SPECTRUM_BINS + heightBin);
+
+    if (!_tofEnabled || p.tofCycles == TOF_INVALID) return;
+
+    uint32_t bin = p.tofCycles / _tofBinCycles;
+    if (bin >= TOF_BINS)
+    {
+        _tofOverflow += delta;
+        return;
+    }
+    _tofHistogram[cls][bin] += delta;
+    if (_tofRegion >= 0) _journal.markDirty(_tofRegion, cls * TOF_BINS + bin);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::processVetoes()
+{
+    noInterrupts();
+    uint32_t head = _vetoHead;
+    interrupts();
+
+    if (head == _vetoTail) return;
+
+    if (head - _vetoTail > VETO_RING_SIZE)
+    {
+        _vetoOverruns += head - _vetoTail - VETO_RING_SIZE;
+        _vetoTail = head - VETO_RING_SIZE;
+    }
+
+    // both sequences are in time order, so a single merge pass tags every coincidence
+    uint16_t e = 0;
+    for (uint32_t v = _vetoTail; v != head; ++v)
+    {
+        uint32_t vetoTime = _vetoTimes[v & (VETO_RING_SIZE - 1)];
+        uint32_t windowStart = vetoTime - _vetoWindowUs;
+        uint32_t windowEnd = vetoTime + _vetoWindowUs;
+
+        if ((int32_t)(windowEnd - _vetoDeadEnd) > 0)
+        {
+            bool overlaps = (int32_t)(windowStart - _vetoDeadEnd) < 0;
+            _vetoDeadTimeUs += overlaps ? (windowEnd - _vetoDeadEnd) : (2 * _vetoWindowUs);
+            _vetoDeadEnd = windowEnd;
+        }
+
+        while (e < _storedCount)
+        {
+            uint16_t slot = (_writeIndex + MAX_PULSES - _storedCount + e) % MAX_PULSES;
+            uint32_t eventTime = (uint32_t)_pulses[slot].timestamp;  // low word of micros64() is micros()
+
+            if ((int32_t)(eventTime - windowStart) < 0)
+            {
+                e++;
+                continue;
+            }
+            if ((int32_t)(eventTime - windowEnd) > 0) break;
+
+            vetoPulse(_pulses[slot]);
+            e++;
+        }
+
+        _lastVetoTime = vetoTime;
+        _vetoCount++;
+    }
+
+    _vetoTail = head;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::isVetoed(uint32_t timestamp) const
+{
+    if (!_vetoEnabled || _vetoCount == 0) return false;
+    return (uint32_t)(timestamp - _lastVetoTime) <= _vetoWindowUs;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::vetoPulse(Pulse& p)
+{
+    if (p.flags & (PULSE_FLAG_VETOED | PULSE_FLAG_PULSER)) return;
+
+    p.flags |= PULSE_FLAG_VETOED;
+
+    if (!_vetoReject)
+    {
+        _vetoTagged++;
+        return;
+    }
+
+    _vetoRejected++;
+    if (_totalPulses > 0) _totalPulses--;
+    if ((p.flags & PULSE_FLAG_NEUTRON) && _neutronCount > 0) _neutronCount--;
+
+    _neutronExpectedQ8 -= p.neutronProbability;
+    _neutronClassVarianceQ16 -= (uint32_t)p.neutronProbability * (255 - p.neutronProbability);
+    accountHistograms(p, -1);
 }
 
-uint16_t NeutronDetector::getPulseCount() const
+template <typename Policies>
+uint16_t BasicNeutronDetector<Policies>::getPulseCount() const
 {
     return _storedCount;
 }
 
-const NeutronDetector::Pulse& NeutronDetector::getPulse(uint16_t index) const
+template <typename Policies>
+const typename BasicNeutronDetector<Policies>::Pulse& BasicNeutronDetector<Policies>::getPulse(uint16_t index) const
 {
     if (index >= _storedCount)
     {
@@ -104,61 +673,191 @@ const NeutronDetector::Pulse& NeutronDetector::getPulse(uint16_t index) const
     return _pulses[actualIndex];
 }
 
-NeutronDetector::PulseAnalysis NeutronDetector::getPulseAnalysis(uint16_t index) const
+template <typename Policies>
+int16_t BasicNeutronDetector<Policies>::leasePulse(uint16_t index)
+{
+    if (index >= _storedCount) return -1;
+
+    uint16_t slot = (_writeIndex + MAX_PULSES - _storedCount + index) % MAX_PULSES;
+    _leases[slot]++;
+    return slot;
+}
+
+template <typename Policies>
+const typename BasicNeutronDetector<Policies>::Pulse& BasicNeutronDetector<Policies>::getLeasedPulse(int16_t slot) const
+{
+    if (slot < 0 || slot >= MAX_PULSES)
+    {
+        static Pulse emptyPulse = {};
+        return emptyPulse;
+    }
+    return _pulses[slot];
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::releasePulse(int16_t slot)
+{
+    if (slot < 0 || slot >= MAX_PULSES || _leases[slot] == 0) return;
+    _leases[slot]--;
+}
+
+template <typename Policies>
+typename BasicNeutronDetector<Policies>::PulseAnalysis BasicNeutronDetector<Policies>::getPulseAnalysis(uint16_t index) const
 {
-    return analyzePulse(getPulse(index));
+    return Policies::Analyzer::analyze(*this, getPulse(index));
 }
 
-bool NeutronDetector::isInputConnected() const
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::isInputConnected() const
 {
     return _inputConnected;
 }
 
-void NeutronDetector::reset()
+template <typename Policies>
+void BasicNeutronDetector<Policies>::reset()
 {
     _writeIndex = 0;
     _storedCount = 0;
 }
 
-uint16_t NeutronDetector::overSample(bool active)
+template <typename Policies>
+uint16_t BasicNeutronDetector<Policies>::readADC()
+{
+#if NEUTRON_FAULT_INJECTION
+    switch (_faultMode)
+    {
+        case FaultMode::SATURATE: return MAX_RAW_VALUE;
+        case FaultMode::FLOATING: return random(MAX_RAW_VALUE + 1);
+        case FaultMode::STUCK: return _faultValue;
+        default: break;
+    }
+#endif
+    return Policies::Source::read(_pin);
+}
+
+#if NEUTRON_FAULT_INJECTION
+template <typename Policies>
+void BasicNeutronDetector<Policies>::injectFault(FaultMode mode, uint32_t durationMs, uint16_t value)
 {
-    if (!active) return analogRead(_pin);
+    uint64_t now = micros64();
 
-    uint32_t sum = 0;
-    uint64_t start = micros();
+    if (mode == FaultMode::NONE)
+    {
+        // ends the active fault through updateFault(), so its recovery is still measured
+        if (_faultMode != FaultMode::NONE) _faultEnd = now;
+        return;
+    }
+
+    // an ADC fault blinds the acquisition, the state before it is what recovery is measured against
+    if (mode != FaultMode::DROP_CLIENT && _faultStart == 0)
+    {
+        _faultStart = now;
+        _faultBaseline = _baseline;
+        _faultThreshold = _threshold;
+        uint64_t liveUs = now - _startTime - _faultBlindTotalUs;
+        _faultRateHz = liveUs > 0 ? _totalPulses * 1000000.0f / liveUs : 0;
+    }
+
+    _faultMode = mode;
+    _faultValue = value;
+    _faultEnd = now + (uint64_t)durationMs * 1000;
+    Serial.printf("[WARN] Injecting fault %u for %u ms\n", (uint8_t)mode, durationMs);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::updateFault()
+{
+    if (_faultMode == FaultMode::NONE) return;
+    if (micros64() < _faultEnd) return;
 
-    for (uint8_t i = 0; i < OVERSAMPLE_COUNT; i++)
+    _faultMode = FaultMode::NONE;
+    _faultClearedAt = micros64();
+    Serial.println("[INFO] Injected fault cleared");
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::isFaultBlinded(uint64_t now)
+{
+    if (_faultStart == 0) return false;
+    if (_faultMode != FaultMode::NONE && _faultMode != FaultMode::DROP_CLIENT) return true;
+
+    // recovered once the baseline and the threshold are back where they were before the fault
+    if (fabs(_baseline - _faultBaseline) > BASELINE_DEVIATION_THRESHOLD) return true;
+    if (_threshold > _faultThreshold + BASELINE_DEVIATION_THRESHOLD) return true;
+
+    // the counted rate before the fault stands for the events missed while blind, whatever the mode
+    _faultRecoveryUs = now - _faultClearedAt;
+    _faultBlindUs = now - _faultStart;
+    _faultBlindTotalUs += _faultBlindUs;
+    _faultLostEvents += lround(_faultRateHz * _faultBlindUs / 1000000.0f);
+    _faultStart = 0;
+    Serial.printf("[INFO] Input recovered %u us after the fault cleared\n", _faultRecoveryUs);
+    return false;
+}
+#endif
+
+template <typename Policies>
+uint16_t BasicNeutronDetector<Policies>::overSample(bool active)
+{
+    if (!active) return readADC();
+
+    uint32_t start = micros();
+    Combiner combiner;
+
+    for (uint8_t i = 0; i < Combiner::READS; i++)
     {
-        sum += analogRead(_pin);
+        combiner.add(i, readADC());
         while (micros() - start < i * OVERSAMPLE_INTERVAL_US)
         {
 
         }
     }
 
-    return sum >> 4;  // dvide by 16 (average of the OVERSAMPLE_COUNT)
+    return combiner.result();
 }
 
-void NeutronDetector::updateBaseline()
+template <typename Policies>
+void BasicNeutronDetector<Policies>::updateBaseline()
 {
     uint16_t newReading = overSample(true);
+    _preTrigger[_preTriggerIndex] = newReading;
+    _preTriggerIndex = (_preTriggerIndex + 1) % PRETRIGGER_SAMPLES;
+    if (_preTriggerCount < PRETRIGGER_SAMPLES) _preTriggerCount++;
+
     float dev = newReading - _baseline;
     _baseline = 0.95f * _baseline + 0.05f * newReading; // filter to stabilize
 
-    if (fabs(dev) > BASELINE_DEVIATION_THRESHOLD)
+    // pulses stay out of the noise estimate, otherwise every pulse ratchets the threshold up until
+    // nothing triggers any more, e.g. after a saturated input
+    if (fabs(dev) < 4 * _noiseRMS)
     {
         updateThreshold(dev);
     }
 }
 
-void NeutronDetector::updateThreshold(float currentDev)
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeLocalBaseline() const
+{
+    if (_preTriggerCount == 0) return _baseline / 4.0f;
+
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < _preTriggerCount; ++i)
+    {
+        sum += _preTrigger[i];
+    }
+    return sum / (4.0f * _preTriggerCount);  // 10-bit readings to 8-bit sample units
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::updateThreshold(float currentDev)
 {
     _noiseRMS = 0.95f * _noiseRMS + 0.05f * fabs(currentDev);
     _noiseRMS = max(_noiseRMS, 2.0f);
     _threshold = _baseline + 4 * _noiseRMS;
 }
 
-float NeutronDetector::computeDecayTime(const Pulse& p) const
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeDecayTime(const Pulse& p) const
 {
     uint8_t peak = 0;
     uint8_t peakIndex = 0;
@@ -172,31 +871,34 @@ float NeutronDetector::computeDecayTime(const Pulse& p) const
         }
     }
 
-    if (peak < MIN_PULSE_AMPLITUDE) return -1.0f;
+    const float amplitude = peak - p.baseline;
+    if (amplitude < MIN_PULSE_AMPLITUDE) return -1.0f;
 
-    const uint8_t threshold = peak * 0.1f;
+    const float threshold = p.baseline + 0.1f * amplitude;
     for (uint8_t i = peakIndex; i < SAMPLES_PER_PULSE; ++i)
     {
         if (p.samples[i] < threshold)
         {
-            return (i - peakIndex) * SAMPLE_INTERVAL_US;
+            return interpolateCrossing(p, i, threshold) - p.sampleTimes[peakIndex];
         }
     }
 
     return -1.0f;
 }
 
-float NeutronDetector::computePulseArea(const Pulse& p) const
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computePulseArea(const Pulse& p) const
 {
     float area = 0;
     for (uint8_t i = 0; i < SAMPLES_PER_PULSE - 1; ++i)
     {
-        area += (p.samples[i] + p.samples[i + 1]) * 0.5f * SAMPLE_INTERVAL_US;
+        area += ((p.samples[i] + p.samples[i + 1]) * 0.5f - p.baseline) * (p.sampleTimes[i + 1] - p.sampleTimes[i]);
     }
     return area;
 }
 
-float NeutronDetector::computeRiseTime(const Pulse& p) const
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeRiseTime(const Pulse& p) const
 {
     uint8_t peak = 0;
     for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
@@ -204,8 +906,9 @@ float NeutronDetector::computeRiseTime(const Pulse& p) const
         if (p.samples[i] > peak) peak = p.samples[i];
     }
 
-    const float threshold10 = 0.1f * peak;
-    const float threshold90 = 0.9f * peak;
+    const float amplitude = peak - p.baseline;
+    const float threshold10 = p.baseline + 0.1f * amplitude;
+    const float threshold90 = p.baseline + 0.9f * amplitude;
     uint8_t t10 = 0;
     uint8_t t90 = 0;
 
@@ -227,31 +930,240 @@ float NeutronDetector::computeRiseTime(const Pulse& p) const
         }
     }
 
-    return (t90 - t10) * SAMPLE_INTERVAL_US;
+    return interpolateCrossing(p, t90, threshold90) - interpolateCrossing(p, t10, threshold10);
 }
 
-NeutronDetector::PulseAnalysis NeutronDetector::analyzePulse(const Pulse& p) const
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeZeroCrossingTime(const Pulse& p) const
 {
-    PulseAnalysis result;
-    result.decayTime = computeDecayTime(p);
-    result.riseTime = computeRiseTime(p);
-    result.pulseArea = computePulseArea(p);
-    result.baseline = _baseline;
-    result.threshold = _threshold;
+    // fixed point Q8 signal, filter state carried sample by sample in one pass
+    const int32_t base = p.baseline * 256.0f;
+    int32_t prevIn = 0;
+    int32_t cr = 0;
+    int32_t rc1 = 0;
+    int32_t rc2 = 0;
+    int32_t prevOut = 0;
+    bool positiveLobe = false;
 
-    result.isNeutron = (result.decayTime > NEUTRON_DECAY_TIME_THRESHOLD) &&
-                      (result.riseTime > NEUTRON_RISE_TIME_THRESHOLD) &&
-                      (result.pulseArea > NEUTRON_AREA_THRESHOLD);
+    for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
+    {
+        int32_t in = ((int32_t)p.samples[i] << 8) - base;
 
-    return result;
-}
+        // Q15 coefficients for this step, a geometric schedule has longer steps in the tail
+        const int32_t dt = i > 0 ? p.sampleTimes[i] - p.sampleTimes[i - 1] : SAMPLE_INTERVAL_US;
+        const int32_t crCoeff = (ZC_TAU_US << 15) / (ZC_TAU_US + dt);
+        const int32_t rcCoeff = (1 << 15) - crCoeff;
 
-bool NeutronDetector::checkInputConnected()
-{
-    int stableReadings = 0;
+        // Q8 differences of full scale pulses exceed 32 bits once multiplied by a Q15 coefficient
+        cr = ((int64_t)crCoeff * (cr + in - prevIn)) >> 15;
+        rc1 += ((int64_t)rcCoeff * (cr - rc1)) >> 15;
+        rc2 += ((int64_t)rcCoeff * (rc1 - rc2)) >> 15;
+        prevIn = in;
+
+        // only a crossing after the positive lobe of a pulse of at least MIN_PULSE_AMPLITUDE counts, not
+        // baseline noise; the shaper passes a fraction of the pulse height, so the amplitude is taken at
+        // its input, Q8 like the signal
+        if (rc2 > 0 && in >= ((int32_t)MIN_PULSE_AMPLITUDE << 8)) positiveLobe = true;
+
+        if (positiveLobe && rc2 <= 0 && prevOut > 0)
+        {
+            const float frac = (float)prevOut / (prevOut - rc2);
+            return p.sampleTimes[i - 1] + frac * (p.sampleTimes[i] - p.sampleTimes[i - 1]);
+        }
+        prevOut = rc2;
+    }
+
+    return -1.0f;
+}
+
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeDecayConstant(const Pulse& p) const
+{
+    uint8_t peakIndex = 0;
+    for (uint8_t i = 1; i < SAMPLES_PER_PULSE; ++i)
+    {
+        if (p.samples[i] > p.samples[peakIndex]) peakIndex = i;
+    }
+
+    // fit log2(y) = a + b * t with weights y, tail times scaled to 10 bits so the int64 sums cannot overflow
+    const int16_t base = p.baseline + 0.5f;
+    const uint16_t span = p.sampleTimes[SAMPLES_PER_PULSE - 1] - p.sampleTimes[peakIndex];
+    uint8_t shift = 0;
+    while ((span >> shift) > 1023) shift++;
+
+    int64_t sw = 0;
+    int64_t swt = 0;
+    int64_t swtt = 0;
+    int64_t swu = 0;
+    int64_t swtu = 0;
+    uint8_t n = 0;
+
+    for (uint8_t i = peakIndex; i < SAMPLES_PER_PULSE; ++i)
+    {
+        int16_t y = p.samples[i] - base;
+        if (y < DECAY_FIT_MIN_AMPLITUDE) break;
+
+        const int64_t w = y;
+        const int64_t t = (p.sampleTimes[i] - p.sampleTimes[peakIndex]) >> shift;
+        const int64_t u = LOG2_Q12.value[y];
+
+        sw += w;
+        swt += w * t;
+        swtt += w * t * t;
+        swu += w * u;
+        swtu += w * t * u;
+        n++;
+    }
+
+    if (n < DECAY_FIT_MIN_POINTS) return -1.0f;
+
+    const int64_t num = sw * swtu - swt * swu;
+    const int64_t den = sw * swtt - swt * swt;
+    if (num >= 0 || den <= 0) return -1.0f;
+
+    // slope b = num / den in Q12 log2 units per scaled us, tau = -1 / (b * ln 2)
+    return -4096.0f * den / (num * 0.69314718f) * (1 << shift);
+}
+
+template <typename Policies>
+float BasicNeutronDetector<Policies>::interpolateCrossing(const Pulse& p, uint8_t i, float level) const
+{
+    if (i == 0) return p.sampleTimes[0];
+
+    const float y0 = p.samples[i - 1];
+    const float y1 = p.samples[i];
+    const float t0 = p.sampleTimes[i - 1];
+    const float t1 = p.sampleTimes[i];
+
+    if (y1 == y0) return t1;
+    return t0 + (level - y0) * (t1 - t0) / (y1 - y0);
+}
+
+template <typename Policies>
+float BasicNeutronDetector<Policies>::computeSampleInterval(const Pulse& p) const
+{
+    return (float)p.sampleTimes[SAMPLES_PER_PULSE - 1] / (SAMPLES_PER_PULSE - 1);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::updateSampleClock(const Pulse& p)
+{
+    // jitter is where each sample was taken against where the schedule put it, whatever its shape
+    float sumSq = 0;
+    for (uint8_t i = 1; i < SAMPLES_PER_PULSE; ++i)
+    {
+        float d = (float)p.sampleTimes[i] - (_sampleSchedule[i] - _sampleSchedule[0]);
+        sumSq += d * d;
+    }
+    float jitter = sqrtf(sumSq / (SAMPLES_PER_PULSE - 1));
+    _sampleJitterUs = 0.9f * _sampleJitterUs + 0.1f * jitter;
+
+    if (_uniformSchedule) _sampleIntervalUs = 0.9f * _sampleIntervalUs + 0.1f * computeSampleInterval(p);
+}
+
+template <typename Policies>
+typename BasicNeutronDetector<Policies>::PulseAnalysis BasicNeutronDetector<Policies>::analyzePulse(const Pulse& p) const
+{
+    PulseAnalysis result;
+    result.decayTime = computeDecayTime(p);
+    result.riseTime = computeRiseTime(p);
+    result.pulseArea = computePulseArea(p);
+    result.zeroCrossingTime = computeZeroCrossingTime(p);
+    result.decayConstant = computeDecayConstant(p);
+    result.baseline = p.baseline * 4.0f;  // back to 10-bit ADC units like _baseline
+    result.threshold = _threshold;
+
+    result.isNeutron = (result.decayTime > NEUTRON_DECAY_TIME_THRESHOLD) &&
+                      (result.riseTime > NEUTRON_RISE_TIME_THRESHOLD) &&
+                      (result.pulseArea > NEUTRON_AREA_THRESHOLD);
+    result.neutronProbability = classify(result);
+
+    return result;
+}
+
+template <typename Policies>
+typename BasicNeutronDetector<Policies>::SelfTestResult BasicNeutronDetector<Policies>::runSelfTest(JsonArray* mismatches)
+{
+    static const char* const featureNames[] = {
+        "decay_time", "rise_time", "pulse_area", "zero_crossing_time", "decay_constant", "neutron_probability"
+    };
+
+    SelfTestResult result = {};
+    uint32_t totalCycles = 0;
+
+    for (uint8_t w = 0; w < GOLDEN_CORPUS_SIZE; ++w)
+    {
+        GoldenWaveform g;
+        memcpy_P(&g, &GOLDEN_CORPUS[w], sizeof(g));
+
+        Pulse p = {};
+        memcpy(p.samples, g.samples, SAMPLES_PER_PULSE);
+        for (uint8_t i = 0; i < SAMPLES_PER_PULSE; ++i)
+        {
+            p.sampleTimes[i] = i * GOLDEN_SAMPLE_INTERVAL_US;
+            if (p.samples[i] > p.peakValue) p.peakValue = p.samples[i];
+        }
+        p.baseline = g.baseline;
+        p.tofCycles = TOF_INVALID;
+
+        // the fastest of a few runs, so an interrupt does not count against the analysis
+        PulseAnalysis a;
+        uint32_t cycles = UINT32_MAX;
+        for (uint8_t r = 0; r < SELFTEST_REPEATS; ++r)
+        {
+            uint32_t start = ESP.getCycleCount();
+            a = analyzePulse(p);
+            uint32_t elapsed = ESP.getCycleCount() - start;
+            if (elapsed < cycles) cycles = elapsed;
+        }
+        totalCycles += cycles;
+        if (cycles > result.maxCycles) result.maxCycles = cycles;
+
+        if (a.isNeutron == (g.label == GOLDEN_NEUTRON)) result.correct++;
+
+        const float actual[] = {
+            a.decayTime, a.riseTime, a.pulseArea, a.zeroCrossingTime, a.decayConstant, a.neutronProbability
+        };
+        const float expected[] = {
+            g.decayTime, g.riseTime, g.pulseArea, g.zeroCrossingTime, g.decayConstant, g.neutronProbability
+        };
+
+        // the expected probabilities only hold for the default classifier
+        uint8_t checked = _classifierCalibrated ? 5 : 6;
+        for (uint8_t f = 0; f < checked; ++f)
+        {
+            float tolerance = max(fabsf(expected[f]) * SELFTEST_FEATURE_TOLERANCE, SELFTEST_FEATURE_ABS_TOLERANCE);
+            if (fabsf(actual[f] - expected[f]) <= tolerance) continue;
+
+            result.featureMismatches++;
+            if (mismatches)
+            {
+                JsonObject m = mismatches->createNestedObject();
+                m["waveform"] = w;
+                m["feature"] = featureNames[f];
+                m["expected"] = expected[f];
+                m["actual"] = actual[f];
+            }
+        }
+    }
+
+    result.waveforms = GOLDEN_CORPUS_SIZE;
+    result.meanCycles = GOLDEN_CORPUS_SIZE > 0 ? totalCycles / GOLDEN_CORPUS_SIZE : 0;
+    result.passed = (result.correct >= SELFTEST_MIN_ACCURACY * result.waveforms) &&
+                    (result.featureMismatches == 0) &&
+                    (result.maxCycles <= SELFTEST_CYCLE_BUDGET_US * _cyclesPerUs);
+
+    _selfTest = result;
+    return result;
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::checkInputConnected()
+{
+    int stableReadings = 0;
     for (int i = 0; i < 10; i++)
     {
-        int val = analogRead(_pin);
+        int val = readADC();
         if (val > 10 && val < MAX_RAW_VALUE - 10)
         {
             stableReadings++;
@@ -261,11 +1173,15 @@ bool NeutronDetector::checkInputConnected()
     return (stableReadings >= 8);
 }
 
-void NeutronDetector::registerHTTPEndpoints(ESP8266WebServer& server)
+template <typename Policies>
+void BasicNeutronDetector<Policies>::registerHTTPEndpoints(ESP8266WebServer& server)
 {
     server.on("/neutron/last", HTTP_GET, [this, &server]()
     {
-        server.send(200, "application/json", getLastPulseJSON());
+        WaveformView view;
+        uint8_t points;
+        parseWaveformViewArgs(server, view, points);
+        sendJSON(server, getLastPulseJSON(view, points));
     });
     
     server.on("/neutron/history", HTTP_GET, [this, &server]()
@@ -273,91 +1189,873 @@ void NeutronDetector::registerHTTPEndpoints(ESP8266WebServer& server)
         String countParam = server.arg("count");
         uint16_t count = countParam.toInt();
         if (count == 0) count = 5;
-        server.send(200, "application/json", getPulseHistoryJSON(count));
+        ResponseSlicer slicer = { ResponseSlicer::Kind::HISTORY };
+        slicer.count = count;
+        parseWaveformViewArgs(server, slicer.view, slicer.points);
+        sendSliced(server, slicer);
     });
     
     server.on("/neutron/stats", HTTP_GET, [this, &server]()
     {
-        server.send(200, "application/json", getStatisticsJSON());
+        sendJSON(server, getStatisticsJSON());
+    });
+
+    server.on("/neutron/stream", HTTP_GET, [this, &server]()
+    {
+        uint32_t cursor = server.hasArg("cursor") ? server.arg("cursor").toInt() : _stream.tail();
+        uint8_t maxEvents = server.arg("max").toInt();
+        if (maxEvents == 0 || maxEvents > STREAM_MAX_EVENTS_PER_READ) maxEvents = STREAM_MAX_EVENTS_PER_READ;
+        sendJSON(server, getStreamJSON(cursor, maxEvents));
+    });
+
+    server.on("/neutron/spectrum", HTTP_GET, [this, &server]()
+    {
+        ResponseSlicer slicer = { ResponseSlicer::Kind::SPECTRUM };
+        sendSliced(server, slicer);
+    });
+
+#if NEUTRON_TRACE
+    server.on("/neutron/trace", HTTP_GET, [this, &server]()
+    {
+        // the ring is several kilobytes of JSON, it goes out in slices like the history, format=raw sends
+        // the records as they are for tools/traceToChrome.py
+        ResponseSlicer slicer = { server.arg("format") == "raw" ? ResponseSlicer::Kind::TRACE_RAW : ResponseSlicer::Kind::TRACE };
+        slicer.trace = StageTrace::open();
+        sendSliced(server, slicer);
+        StageTrace::close();
+        if (server.arg("clear") == "1") StageTrace::clear();
     });
+#endif
+
+#if NEUTRON_FAULT_INJECTION
+    server.on("/neutron/fault", HTTP_GET, [this, &server]()
+    {
+        String modeParam = server.arg("mode");
+        FaultMode mode = FaultMode::NONE;
+        if (modeParam == "saturate") mode = FaultMode::SATURATE;
+        else if (modeParam == "floating") mode = FaultMode::FLOATING;
+        else if (modeParam == "stuck") mode = FaultMode::STUCK;
+        else if (modeParam == "drop") mode = FaultMode::DROP_CLIENT;
+
+        uint32_t durationMs = server.arg("duration_ms").toInt();
+        if (durationMs == 0) durationMs = 1000;
+        injectFault(mode, durationMs, server.arg("value").toInt());
+        sendJSON(server, "{\"status\":\"ok\"}");
+    });
+#endif
+
+    server.on("/neutron/rates", HTTP_GET, [this, &server]()
+    {
+        sendJSON(server, getRatesJSON());
+    });
+
+    if constexpr (Sinks::template has<NeutronCorrelation>())
+    {
+        server.on("/neutron/correlation", HTTP_GET, [this, &server]()
+        {
+            sendJSON(server, getCorrelationJSON());
+        });
+    }
+
+    if constexpr (Sinks::template has<FeynmanAnalysis>())
+    {
+        server.on("/neutron/feynman", HTTP_GET, [this, &server]()
+        {
+            sendJSON(server, getFeynmanJSON());
+        });
+    }
+
+    server.on("/neutron/tof", HTTP_GET, [this, &server]()
+    {
+        if (!_tofEnabled)
+        {
+            sendJSON(server, getTOFHistogramJSON());
+            return;
+        }
+        ResponseSlicer slicer = { ResponseSlicer::Kind::TOF };
+        sendSliced(server, slicer);
+    });
+
+    server.on("/neutron/selftest", HTTP_GET, [this, &server]()
+    {
+        sendJSON(server, getSelfTestJSON());
+    });
+
+    server.on("/neutron/time", HTTP_GET, [this, &server]()
+    {
+        sendJSON(server, getTimeJSON());
+    });
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::checkClient(ESP8266WebServer& server)
+{
+#if NEUTRON_FAULT_INJECTION
+    updateFault();
+    if (_faultMode == FaultMode::DROP_CLIENT) server.client().stop();
+#endif
+
+    if (!server.client().connected())
+    {
+        _clientDrops++;
+        return false;
+    }
+    return true;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::sendJSON(ESP8266WebServer& server, const String& body)
+{
+    TRACE_SCOPE(TraceStage::TRANSPORT);
+
+    if (!checkClient(server)) return;
+    server.send(200, "application/json", body);
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::sendSliced(ESP8266WebServer& server, ResponseSlicer& s)
+{
+    if (!checkClient(server)) return;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, s.kind == ResponseSlicer::Kind::TRACE_RAW ? "application/octet-stream" : "application/json", "");
+
+    String slice;
+    slice.reserve(RESPONSE_SLICE_BYTES);
+    bool more = true;
+
+    while (more)
+    {
+        uint32_t start = micros();
+        {
+            TRACE_SCOPE(TraceStage::TRANSPORT);
+            slice = "";
+            more = nextSlice(s, slice);
+            server.sendContent(slice);
+        }
+        uint32_t elapsed = micros() - start;
+        if (elapsed > _maxSliceUs) _maxSliceUs = elapsed;
+
+        if (!server.client().connected())
+        {
+            _clientDrops++;
+            releaseSlicer(s);
+            return;
+        }
+
+        // acquisition runs between the slices, so it never waits longer than one slice
+        if (more) update();
+    }
+
+    server.sendContent("");
+}
+
+template <typename Policies>
+bool BasicNeutronDetector<Policies>::nextSlice(ResponseSlicer& s, String& out)
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+
+#if NEUTRON_TRACE
+    if (s.kind == ResponseSlicer::Kind::TRACE)
+    {
+        if (!StageTrace::writeChromeJSON(out, s.trace, RESPONSE_SLICE_BYTES)) s.phase = 4;
+        return s.phase < 4;
+    }
+    if (s.kind == ResponseSlicer::Kind::TRACE_RAW)
+    {
+        if (!StageTrace::writeRaw(out, s.trace, RESPONSE_SLICE_BYTES)) s.phase = 4;
+        return s.phase < 4;
+    }
+#endif
+
+    switch (s.phase)
+    {
+        case 0:
+            if (s.kind == ResponseSlicer::Kind::HISTORY)
+            {
+                uint16_t count = min(s.count, getPulseCount());
+                s.end = _pulseSeq;
+                s.next = _pulseSeq - count;
+                s.phase = count > 0 ? 1 : 3;
+
+                // the whole window stays leased until it is sent, captures between the slices go to other slots
+                for (uint16_t i = 0; i < count; ++i)
+                {
+                    int16_t slot = leasePulse(getPulseCount() - count + i);
+                    if (i == 0) s.slot = slot;
+                }
+                out += "{\"pulses\":[";
+                break;
+            }
+            if (s.kind == ResponseSlicer::Kind::TOF)
+            {
+                out += "{\"bin_width_us\":";
+                out += String(_tofBinCycles / _cyclesPerUs);
+                out += ",\"start_count\":";
+                out += String((uint32_t)_startCount);
+                out += ",\"overflow\":";
+                out += String(_tofOverflow);
+                out += ",\"stale_starts\":";
+                out += String(_tofStaleStarts);
+                out += ",\"trigger_latency_us\":";
+                out += String(_triggerLatencyUs);
+                out += ",\"neutron\":[";
+            }
+            else
+            {
+                out += "{\"bin_width\":4,\"neutron\":[";
+            }
+            s.phase = 1;
+            break;
+
+        case 1:
+        case 2:
+            if (s.kind == ResponseSlicer::Kind::HISTORY)
+            {
+                sliceHistoryPulse(s, out);
+            }
+            else if (s.kind == ResponseSlicer::Kind::TOF)
+            {
+                sliceHistogram(s, out, _tofHistogram[s.phase == 1 ? 1 : 0], TOF_BINS);
+            }
+            else
+            {
+                sliceHistogram(s, out, _spectrum[s.phase == 1 ? 1 : 0], SPECTRUM_BINS);
+            }
+            break;
+
+        case 3:
+            if (s.kind == ResponseSlicer::Kind::HISTORY)
+            {
+                out += "],\"count\":";
+                out += String(s.emitted);
+                out += ",\"total_pulses\":";
+                out += String(_totalPulses);
+                out += ",\"neutron_count\":";
+                out += String(_neutronCount);
+                out += "}";
+            }
+            else
+            {
+                out += "]}";
+            }
+            s.phase = 4;
+            break;
+
+        default:
+            break;
+    }
+
+    return s.phase < 4;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::sliceHistoryPulse(ResponseSlicer& s, String& out)
+{
+    char frame[RESPONSE_SLICE_BYTES];
+    size_t length = encodePulse(frame, sizeof(frame), getLeasedPulse(s.slot), s.view, s.points);
+
+    if (length == 0)
+    {
+        // keep the place of the pulse, a client counting entries must not miss one
+        JsonWriter w(frame, sizeof(frame));
+        w.key(PSTR("{\"status\":\"error\",\"message\":\"pulse_too_large\",\"timestamp\":"));
+        w.number64(getLeasedPulse(s.slot).timestamp);
+        w.raw('}');
+        length = w.finish();
+    }
+    if (s.emitted > 0) out += ',';
+    out.concat(frame, length);
+    s.emitted++;
+
+    releasePulse(s.slot);
+    s.slot = (s.slot + 1) % MAX_PULSES;
+    s.next++;
+    if (s.next == s.end) s.phase = 3;
 }
 
-String NeutronDetector::getLastPulseJSON()
+template <typename Policies>
+void BasicNeutronDetector<Policies>::releaseSlicer(ResponseSlicer& s)
 {
+    if (s.kind != ResponseSlicer::Kind::HISTORY || s.phase < 1 || s.phase > 2) return;
+
+    for (; s.next != s.end; s.next++)
+    {
+        releasePulse(s.slot);
+        s.slot = (s.slot + 1) % MAX_PULSES;
+    }
+    s.phase = 4;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::sliceHistogram(ResponseSlicer& s, String& out, const uint32_t* bins, uint8_t count)
+{
+    // a bin takes at most 11 bytes with its separator, the array change at most 12
+    size_t limit = out.length() + RESPONSE_SLICE_BYTES - 12;
+    while (s.index < count && out.length() + 11 <= limit)
+    {
+        if (s.index > 0) out += ',';
+        out += String(bins[s.index++]);
+    }
+    if (s.index < count) return;
+
+    s.index = 0;
+    if (s.phase == 1) out += "],\"gamma\":[";
+    s.phase++;
+}
+
+template <typename Policies>
+void BasicNeutronDetector<Policies>::parseWaveformViewArgs(ESP8266WebServer& server, WaveformView& view, uint8_t& points)
+{
+    String viewParam = server.arg("view");
+    if (viewParam == "minmax") view = WaveformView::MINMAX;
+    else if (viewParam == "lttb") view = WaveformView::LTTB;
+    else view = WaveformView::RAW;
+
+    long pointsParam = server.arg("points").toInt();
+    if (pointsParam <= 0 || pointsParam > SAMPLES_PER_PULSE) pointsParam = SAMPLES_PER_PULSE;
+    points = pointsParam;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getLastPulseJSON(WaveformView view, uint8_t points)
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
     if (getPulseCount() == 0)
     {
         return "{\"status\":\"error\",\"message\":\"no_pulses_detected\"}";
     }
 
-    DynamicJsonDocument doc(1024);
-    uint16_t lastIndex = getPulseCount() - 1;
-    addPulseToJSON(doc, lastIndex);
-    
+    char frame[RESPONSE_SLICE_BYTES];
+    size_t length = encodePulse(frame, sizeof(frame), getPulse(getPulseCount() - 1), view, points);
+    if (length == 0)
+    {
+        return "{\"status\":\"error\",\"message\":\"pulse_too_large\"}";
+    }
+
     String output;
-    serializeJson(doc, output);
+    output.concat(frame, length);
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getPulseHistoryJSON(uint16_t count, WaveformView view, uint8_t points)
+{
+    ResponseSlicer slicer = { ResponseSlicer::Kind::HISTORY };
+    slicer.count = count;
+    slicer.view = view;
+    slicer.points = points;
+
+    String output;
+    while (nextSlice(slicer, output))
+    {
+
+    }
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getSpectrumJSON()
+{
+    ResponseSlicer slicer = { ResponseSlicer::Kind::SPECTRUM };
+
+    String output;
+    while (nextSlice(slicer, output))
+    {
+
+    }
     return output;
 }
 
-String NeutronDetector::getPulseHistoryJSON(uint16_t count)
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getRatesJSON()
 {
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
     DynamicJsonDocument doc(2048);
-    JsonArray pulses = doc.createNestedArray("pulses");
 
-    uint16_t actualCount = min(count, getPulseCount());
-    uint16_t startIndex = (getPulseCount() >= count) ? (getPulseCount() - count) : 0;
+    // the spectra may hold counts restored from flash, so the time must include those runs too
+    const float elapsed = _restoredSeconds + (micros64() - _startTime) / 1000000.0f;
+    doc["elapsed_s"] = elapsed;
+
+    float totalNeutron = 0;
+    float totalGamma = 0;
+    float varNeutron = 0;
+    float varGamma = 0;
+
+    uint32_t counts[ENERGY_BANDS][2];
+    computeBandCounts(counts);
 
-    for (uint16_t i = startIndex; i < startIndex + actualCount; i++)
+    JsonArray bands = doc.createNestedArray("bands");
+    for (uint8_t b = 0; b < ENERGY_BANDS; b++)
     {
-        JsonObject pulseObj = pulses.createNestedObject();
-        DynamicJsonDocument pulseDoc(512);
-        addPulseToJSON(pulseDoc, i);
-        pulseObj.set(pulseDoc.as<JsonObject>());
+        // observed = M * true with M = [[1 - eGN, eNG], [eGN, 1 - eNG]], inverted in closed form
+        const float obsN = counts[b][1];
+        const float obsG = counts[b][0];
+        const float eNG = _gammaAsNeutron[b];
+        const float eGN = _neutronAsGamma[b];
+        const float det = 1.0f - eNG - eGN;
+
+        const float trueN = ((1.0f - eNG) * obsN - eNG * obsG) / det;
+        const float trueG = ((1.0f - eGN) * obsG - eGN * obsN) / det;
+
+        // independent Poisson observed counts, calibration uncertainty not included
+        const float vN = ((1.0f - eNG) * (1.0f - eNG) * obsN + eNG * eNG * obsG) / (det * det);
+        const float vG = ((1.0f - eGN) * (1.0f - eGN) * obsG + eGN * eGN * obsN) / (det * det);
+
+        totalNeutron += trueN;
+        totalGamma += trueG;
+        varNeutron += vN;
+        varGamma += vG;
+
+        JsonObject band = bands.createNestedObject();
+        band["min_height"] = b == 0 ? 0 : _bandEdges[b - 1];
+        band["observed_neutron"] = counts[b][1];
+        band["observed_gamma"] = counts[b][0];
+        band["neutron"] = trueN;
+        band["neutron_sigma"] = sqrtf(vN);
+        band["gamma"] = trueG;
+        band["gamma_sigma"] = sqrtf(vG);
     }
 
-    doc["count"] = actualCount;
-    doc["total_pulses"] = _totalPulses;
-    doc["neutron_count"] = _neutronCount;
+    doc["neutron"] = totalNeutron;
+    doc["neutron_sigma"] = sqrtf(varNeutron);
+    doc["gamma"] = totalGamma;
+    doc["gamma_sigma"] = sqrtf(varGamma);
+    if (elapsed > 0)
+    {
+        doc["neutron_rate"] = totalNeutron / elapsed;
+        doc["neutron_rate_sigma"] = sqrtf(varNeutron) / elapsed;
+        doc["gamma_rate"] = totalGamma / elapsed;
+        doc["gamma_rate_sigma"] = sqrtf(varGamma) / elapsed;
+    }
 
     String output;
     serializeJson(doc, output);
     return output;
 }
 
-String NeutronDetector::getStatisticsJSON()
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getCorrelationJSON()
 {
-    DynamicJsonDocument doc(512);
-    
-    doc["total_pulses"] = _totalPulses;
-    doc["neutron_count"] = _neutronCount;
-    doc["last_neutron_time"] = _lastNeutronTime;
-    doc["max_pulse_area"] = _maxPulseArea;
-    doc["max_decay_time"] = _maxDecayTime;
-    doc["current_baseline"] = _baseline;
-    doc["current_threshold"] = _threshold;
-    doc["input_connected"] = _inputConnected;
-    
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    DynamicJsonDocument doc(3072);
+    _sinks.template apply<NeutronCorrelation>([&](const NeutronCorrelation& c) { c.toJSON(doc); });
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getFeynmanJSON()
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    DynamicJsonDocument doc(3072);
+
+    // every trigger, neutron or not, holds the input dead for DEAD_TIME_US
+    const float seconds = (micros64() - _startTime) / 1000000.0f;
+    const float triggerRate = seconds > 0 ? _totalPulses / seconds : 0.0f;
+    const float neutronFraction = _totalPulses > 0 ? (float)_neutronCount / _totalPulses : 0.0f;
+    _sinks.template apply<FeynmanAnalysis>([&](const FeynmanAnalysis& f) { f.toJSON(doc, triggerRate, neutronFraction); });
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getTOFHistogramJSON()
+{
+    if (!_tofEnabled)
+    {
+        return "{\"status\":\"error\",\"message\":\"tof_disabled\"}";
+    }
+
+    ResponseSlicer slicer = { ResponseSlicer::Kind::TOF };
+
+    String output;
+    while (nextSlice(slicer, output))
+    {
+
+    }
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getStreamJSON(uint32_t cursor, uint8_t maxEvents)
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    _lastStreamRead = micros64();
+    _streamActive = true;
+
+    uint32_t skipped = _stream.clampCursor(cursor);
+    _streamSkipped += skipped;
+
+    uint32_t end = _stream.head();
+    if (end - cursor > maxEvents) end = cursor + maxEvents;
+
+    // frames are already encoded, a read only copies bytes so its cost does not depend on other subscribers
+    size_t total = 64;
+    for (uint32_t seq = cursor; seq != end; ++seq)
+    {
+        const char* data;
+        uint16_t length;
+        if (_stream.getFrame(seq, data, length)) total += length + 1;
+    }
+
+    String output;
+    output.reserve(total);
+    output += "{\"cursor\":";
+    output += String(end);
+    output += ",\"device_time\":";
+    output += String(micros64());
+    output += ",\"skipped\":";
+    output += String(skipped);
+    output += ",\"events\":[";
+
+    for (uint32_t seq = cursor; seq != end; ++seq)
+    {
+        const char* data;
+        uint16_t length;
+        if (!_stream.getFrame(seq, data, length)) continue;
+        if (seq != cursor) output += ',';
+        output.concat(data, length);
+    }
+
+    output += "]}";
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getSelfTestJSON()
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    DynamicJsonDocument doc(2048);
+
+    doc["corpus_version"] = GOLDEN_CORPUS_VERSION;
+    JsonArray mismatches = doc.createNestedArray("mismatches");
+    SelfTestResult result = runSelfTest(&mismatches);
+
+    doc["waveforms"] = result.waveforms;
+    doc["correct"] = result.correct;
+    doc["accuracy"] = result.waveforms > 0 ? (float)result.correct / result.waveforms : 0.0f;
+    doc["min_accuracy"] = SELFTEST_MIN_ACCURACY;
+    doc["feature_mismatches"] = result.featureMismatches;
+    doc["probability_checked"] = !_classifierCalibrated;
+    doc["mean_cycles"] = result.meanCycles;
+    doc["max_cycles"] = result.maxCycles;
+    doc["cycle_budget"] = SELFTEST_CYCLE_BUDGET_US * _cyclesPerUs;
+    doc["passed"] = result.passed;
+
     String output;
     serializeJson(doc, output);
     return output;
 }
 
-void NeutronDetector::addPulseToJSON(JsonDocument& doc, uint16_t index) const
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getTimeJSON()
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    String output;
+    output.reserve(40);
+    output += "{\"device_time\":";
+    output += String(micros64());
+    output += "}";
+    return output;
+}
+
+template <typename Policies>
+String BasicNeutronDetector<Policies>::getStatisticsJSON()
+{
+    TRACE_SCOPE(TraceStage::SERIALIZATION);
+    String output;
+    output.reserve(STATS_JSON_RESERVE);
+    char buffer[64];
+    JsonWriter w(buffer, sizeof(buffer), &output);
+
+    w.key(PSTR("{\"total_pulses\":"));
+    w.number(_totalPulses);
+    w.key(PSTR(",\"neutron_count\":"));
+    w.number(_neutronCount);
+    w.key(PSTR(",\"neutron_expected\":"));
+    const double neutronExpected = _neutronExpectedQ8 / 255.0;
+    w.fixed(neutronExpected, 3);
+    // Poisson arrival plus per-event class uncertainty: sum p^2 + sum p(1 - p) = sum p
+    w.key(PSTR(",\"neutron_expected_sigma\":"));
+    w.fixed(sqrt(neutronExpected), 3);
+    w.key(PSTR(",\"neutron_class_variance\":"));
+    w.fixed(_neutronClassVarianceQ16 / (255.0 * 255.0), 3);
+    w.key(PSTR(",\"last_neutron_time\":"));
+    w.number64(_lastNeutronTime);
+    w.key(PSTR(",\"max_pulse_area\":"));
+    w.fixed(_maxPulseArea, 1);
+    w.key(PSTR(",\"max_decay_time\":"));
+    w.fixed(_maxDecayTime, 3);
+    w.key(PSTR(",\"current_baseline\":"));
+    w.fixed(_baseline, 2);
+    if (_uniformSchedule)
+    {
+        w.key(PSTR(",\"sample_rate_hz\":"));
+        w.fixed(_sampleIntervalUs > 0 ? 1000000.0f / _sampleIntervalUs : 0.0f, 1);
+        w.key(PSTR(",\"sample_interval_us\":"));
+        w.fixed(_sampleIntervalUs, 3);
+    }
+    w.key(PSTR(",\"sample_jitter_us\":"));
+    w.fixed(_sampleJitterUs, 3);
+    w.key(PSTR(",\"current_threshold\":"));
+    w.number(_threshold);
+    w.key(PSTR(",\"input_connected\":"));
+    w.boolean(_inputConnected);
+    w.key(PSTR(",\"checkpoint_count\":"));
+    w.number(_journal.getCheckpointCount());
+    w.key(PSTR(",\"journal_bytes\":"));
+    w.number(_journal.getJournalSize());
+    w.key(PSTR(",\"restore_time_us\":"));
+    w.number(_journal.getRestoreTime());
+    w.key(PSTR(",\"captures_lost_lease\":"));
+    w.number(_capturesLostToLease);
+    w.key(PSTR(",\"saturated_captures\":"));
+    w.number(_saturatedCaptures);
+    w.key(PSTR(",\"disconnect_resets\":"));
+    w.number(_disconnectResets);
+    w.key(PSTR(",\"client_drops\":"));
+    w.number(_clientDrops);
+    w.key(PSTR(",\"max_slice_us\":"));
+    w.number(_maxSliceUs);
+    w.key(PSTR(",\"self_test_passed\":"));
+    w.boolean(_selfTest.passed);
+#if NEUTRON_FAULT_INJECTION
+    w.key(PSTR(",\"fault_mode\":"));
+    w.number((uint8_t)_faultMode);
+    w.key(PSTR(",\"fault_lost_events\":"));
+    w.number(_faultLostEvents);
+    w.key(PSTR(",\"fault_recovery_us\":"));
+    w.number(_faultRecoveryUs);
+    w.key(PSTR(",\"fault_blind_us\":"));
+    w.number(_faultBlindUs);
+#endif
+    if (_pulserPeriodUs > 0)
+    {
+        w.key(PSTR(",\"pulser_requested\":"));
+        w.number(_pulserRequested);
+        w.key(PSTR(",\"pulser_recorded\":"));
+        w.number(_pulserRecorded);
+        w.key(PSTR(",\"live_fraction\":"));
+        w.fixed(_pulserRequested > 0 ? (float)_pulserRecorded / _pulserRequested : 1.0f, 4);
+        w.key(PSTR(",\"pulser_baseline\":"));
+        w.fixed(_pulserBaseline, 2);
+        w.key(PSTR(",\"pulser_noise_rms\":"));
+        w.fixed(_pulserNoiseRMS, 2);
+    }
+    w.key(PSTR(",\"stream_skipped\":"));
+    w.number(_streamSkipped);
+    w.key(PSTR(",\"stream_dropped\":"));
+    w.number(_streamDropped);
+
+    if (_vetoEnabled)
+    {
+        uint64_t elapsed = micros64() - _vetoEnabledAt;
+        w.key(PSTR(",\"veto_count\":"));
+        w.number(_vetoCount);
+        w.key(PSTR(",\"veto_rejected\":"));
+        w.number(_vetoRejected);
+        w.key(PSTR(",\"veto_tagged\":"));
+        w.number(_vetoTagged);
+        w.key(PSTR(",\"veto_overruns\":"));
+        w.number(_vetoOverruns);
+        w.key(PSTR(",\"veto_dead_time_us\":"));
+        w.number64(_vetoDeadTimeUs);
+        w.key(PSTR(",\"veto_live_fraction\":"));
+        w.fixed(elapsed > 0 ? 1.0f - (float)_vetoDeadTimeUs / elapsed : 1.0f, 4);
+    }
+    w.raw('}');
+
+    w.finish();
+    return output;
+}
+
+template <typename Policies>
+size_t BasicNeutronDetector<Policies>::encodePulse(char* buffer, size_t size, const Pulse& pulse, WaveformView view, uint8_t points,
+                                    uint64_t* serializedAt, const PulseAnalysis* analyzed)
+{
+    // the stream publishes right after capturePulse() analyzed the pulse, only the pulser and the responses analyze here
+    const PulseAnalysis analysis = analyzed ? *analyzed : Policies::Analyzer::analyze(*this, pulse);
+
+    JsonWriter w(buffer, size);
+    w.key(PSTR("{\"timestamp\":"));
+    w.number64(pulse.timestamp);
+    // stage latencies for trigger-to-client measurements, serialized_us closes the object
+    w.key(PSTR(",\"capture_us\":"));
+    w.number(pulse.captureUs);
+    w.key(PSTR(",\"analysis_us\":"));
+    w.number(pulse.analysisUs);
+    w.key(PSTR(",\"decay_time\":"));
+    w.fixed(analysis.decayTime, 3);
+    w.key(PSTR(",\"rise_time\":"));
+    w.fixed(analysis.riseTime, 3);
+    w.key(PSTR(",\"pulse_area\":"));
+    w.fixed(analysis.pulseArea, 1);
+    w.key(PSTR(",\"zero_crossing_time\":"));
+    w.fixed(analysis.zeroCrossingTime, 3);
+    w.key(PSTR(",\"decay_constant\":"));
+    w.fixed(analysis.decayConstant, 3);
+    w.key(PSTR(",\"is_neutron\":"));
+    w.boolean(analysis.isNeutron);
+    w.key(PSTR(",\"neutron_probability\":"));
+    w.fixed(analysis.neutronProbability, 4);
+    w.key(PSTR(",\"baseline\":"));
+    w.fixed(analysis.baseline, 2);
+    w.key(PSTR(",\"threshold\":"));
+    w.fixed(analysis.threshold, 2);
+    w.key(PSTR(",\"peak_value\":"));
+    w.number(pulse.peakValue);
+    if (_uniformSchedule)
+    {
+        w.key(PSTR(",\"sample_interval_us\":"));
+        w.fixed(computeSampleInterval(pulse), 3);
+    }
+    w.key(PSTR(",\"sample_times\":"));
+    w.array(pulse.sampleTimes, SAMPLES_PER_PULSE);
+    w.key(PSTR(",\"vetoed\":"));
+    w.boolean((pulse.flags & PULSE_FLAG_VETOED) != 0);
+    w.key(PSTR(",\"pulser\":"));
+    w.boolean((pulse.flags & PULSE_FLAG_PULSER) != 0);
+    if (pulse.tofCycles != TOF_INVALID)
+    {
+        w.key(PSTR(",\"tof_us\":"));
+        w.fixed((float)pulse.tofCycles / _cyclesPerUs, 2);
+    }
+
+    uint8_t first[SAMPLES_PER_PULSE];
+    uint8_t second[SAMPLES_PER_PULSE];
+    if (view == WaveformView::MINMAX)
+    {
+        uint8_t n = computeMinMaxEnvelope(pulse, points, first, second);
+        w.key(PSTR(",\"envelope_min\":"));
+        w.array(first, n);
+        w.key(PSTR(",\"envelope_max\":"));
+        w.array(second, n);
+    }
+    else if (view == WaveformView::LTTB)
+    {
+        uint8_t n = computeLTTB(pulse, points, first, second);
+        w.key(PSTR(",\"lttb_index\":"));
+        w.array(first, n);
+        w.key(PSTR(",\"lttb_value\":"));
+        w.array(second, n);
+    }
+    else
+    {
+        w.key(PSTR(",\"raw_samples\":"));
+        w.array(pulse.samples, SAMPLES_PER_PULSE);
+    }
+
+    // taken once, when the stream frame is encoded; history and last responses repeat it
+    const uint64_t stamp = serializedAt ? micros64() : pulse.serializedAt;
+    if (stamp != 0)
+    {
+        w.key(PSTR(",\"serialized_us\":"));
+        w.number64(stamp - pulse.timestamp);
+    }
+    if (serializedAt) *serializedAt = stamp;
+    w.raw('}');
+
+    return w.finish();
+}
+
+template <typename Policies>
+uint8_t BasicNeutronDetector<Policies>::computeMinMaxEnvelope(const Pulse& p, uint8_t buckets, uint8_t* minOut, uint8_t* maxOut) const
 {
-    const Pulse& pulse = getPulse(index);
-    PulseAnalysis analysis = getPulseAnalysis(index);
+    if (buckets == 0) buckets = 1;
+    if (buckets > SAMPLES_PER_PULSE) buckets = SAMPLES_PER_PULSE;
+
+    for (uint8_t b = 0; b < buckets; b++)
+    {
+        uint8_t start = (uint16_t)b * SAMPLES_PER_PULSE / buckets;
+        uint8_t end = (uint16_t)(b + 1) * SAMPLES_PER_PULSE / buckets;
+        uint8_t lo = MAX_SAMPLE_VALUE;
+        uint8_t hi = 0;
+
+        for (uint8_t i = start; i < end; i++)
+        {
+            if (p.samples[i] < lo) lo = p.samples[i];
+            if (p.samples[i] > hi) hi = p.samples[i];
+        }
+        minOut[b] = lo;
+        maxOut[b] = hi;
+    }
 
-    doc["timestamp"] = pulse.timestamp;
-    doc["decay_time"] = analysis.decayTime;
-    doc["rise_time"] = analysis.riseTime;
-    doc["pulse_area"] = analysis.pulseArea;
-    doc["is_neutron"] = analysis.isNeutron;
-    doc["baseline"] = analysis.baseline;
-    doc["threshold"] = analysis.threshold;
-    doc["peak_value"] = pulse.peakValue;
+    return buckets;
+}
 
-    JsonArray samples = doc.createNestedArray("raw_samples");
-    for (uint8_t i = 0; i < SAMPLES_PER_PULSE; i++)
+template <typename Policies>
+uint8_t BasicNeutronDetector<Policies>::computeLTTB(const Pulse& p, uint8_t points, uint8_t* indexOut, uint8_t* valueOut) const
+{
+    if (points >= SAMPLES_PER_PULSE || points < 3)
     {
-        samples.add(pulse.samples[i]);
+        if (points < 2) points = 2;
+        if (points > SAMPLES_PER_PULSE) points = SAMPLES_PER_PULSE;
+
+        // nothing to choose from, spread the points evenly including both ends
+        for (uint8_t i = 0; i < points; i++)
+        {
+            indexOut[i] = (uint16_t)i * (SAMPLES_PER_PULSE - 1) / (points - 1);
+            valueOut[i] = p.samples[indexOut[i]];
+        }
+        return points;
+    }
+
+    const uint8_t inner = SAMPLES_PER_PULSE - 2;
+    const uint8_t buckets = points - 2;
+    uint8_t selected = 0;
+
+    indexOut[0] = 0;
+    valueOut[0] = p.samples[0];
+
+    for (uint8_t b = 0; b < buckets; b++)
+    {
+        uint8_t start = 1 + (uint16_t)b * inner / buckets;
+        uint8_t end = 1 + (uint16_t)(b + 1) * inner / buckets;
+
+        // average of the next bucket, the last sample closes the final bucket; x is the measured sample
+        // time, so a non-uniform schedule weighs the triangles by real time
+        uint8_t nextStart = end;
+        uint8_t nextEnd = (b + 1 < buckets) ? 1 + (uint16_t)(b + 2) * inner / buckets : SAMPLES_PER_PULSE;
+        float avgX = 0;
+        float avgY = 0;
+        for (uint8_t i = nextStart; i < nextEnd; i++)
+        {
+            avgX += p.sampleTimes[i];
+            avgY += p.samples[i];
+        }
+        avgX /= (nextEnd - nextStart);
+        avgY /= (nextEnd - nextStart);
+
+        const float ax = p.sampleTimes[indexOut[selected]];
+        const float ay = valueOut[selected];
+        float maxArea = -1.0f;
+        uint8_t best = start;
+
+        for (uint8_t i = start; i < end; i++)
+        {
+            float area = fabs((ax - avgX) * (p.samples[i] - ay) - (ax - p.sampleTimes[i]) * (avgY - ay));
+            if (area > maxArea)
+            {
+                maxArea = area;
+                best = i;
+            }
+        }
+
+        selected++;
+        indexOut[selected] = best;
+        valueOut[selected] = p.samples[best];
     }
-}
\ No newline at end of file
+
+    selected++;
+    indexOut[selected] = SAMPLES_PER_PULSE - 1;
+    valueOut[selected] = p.samples[SAMPLES_PER_PULSE - 1];
+
+    return selected + 1;
+}
+
+template class BasicNeutronDetector<DefaultPolicies>;
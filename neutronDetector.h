@@ -4,17 +4,140 @@
 #include <ESP8266WiFi.h>
 #include <ESP8266WebServer.h>
 #include <ArduinoJson.h>
+#include "frameRing.h"
+#include "histogramJournal.h"
+#include "neutronCorrelation.h"
+#include "feynmanAnalysis.h"
+#include "stageTrace.h"
+#include "goldenCorpus.h"
+#include "acquisitionPipeline.h"
+#include "jsonWriter.h"
 
-/// @brief Class for detecting neutron pulses using an analog input. \class NeutronDetector
-class NeutronDetector
+#define NEUTRON_COMBINER_MEAN 0
+#define NEUTRON_COMBINER_MEDIAN3 1
+#define NEUTRON_COMBINER_TRIMMED 2
+#define NEUTRON_COMBINER_NONE 3
+
+/// Build with -DNEUTRON_FAULT_INJECTION=1 to enable the ADC and network fault injector
+#ifndef NEUTRON_FAULT_INJECTION
+#define NEUTRON_FAULT_INJECTION 0
+#endif
+
+/// Build with -DNEUTRON_VETO=1 to enable the veto input on D5, it needs an external pull-down (see the sketch)
+#ifndef NEUTRON_VETO
+#define NEUTRON_VETO 0
+#endif
+
+/// Build with -DNEUTRON_START_INPUT=1 to enable the TOF start input on D6, it needs an external pull-down
+#ifndef NEUTRON_START_INPUT
+#define NEUTRON_START_INPUT 0
+#endif
+
+/// Filter stage combiner used by overSample(), override with -DNEUTRON_OVERSAMPLE_COMBINER=...
+#ifndef NEUTRON_OVERSAMPLE_COMBINER
+#define NEUTRON_OVERSAMPLE_COMBINER NEUTRON_COMBINER_MEAN
+#endif
+
+/// Analyses fed with every counted neutron, override with e.g. -DNEUTRON_EVENT_SINKS=FeynmanAnalysis
+#ifndef NEUTRON_EVENT_SINKS
+#define NEUTRON_EVENT_SINKS NeutronCorrelation, FeynmanAnalysis
+#endif
+
+/// Source stage, override with -DNEUTRON_SOURCE=... for another converter
+#ifndef NEUTRON_SOURCE
+#define NEUTRON_SOURCE AnalogSource
+#endif
+
+/// Trigger stage, override with e.g. -DNEUTRON_TRIGGER=EdgeTrigger
+#ifndef NEUTRON_TRIGGER
+#define NEUTRON_TRIGGER LevelTrigger
+#endif
+
+/// Capture stage, override with e.g. -DNEUTRON_CAPTURE=RawCapture
+#ifndef NEUTRON_CAPTURE
+#define NEUTRON_CAPTURE FilteredCapture
+#endif
+
+/// Analyzer stage, override with e.g. -DNEUTRON_ANALYZER=CountingAnalyzer for a counter without pulse shape discrimination
+#ifndef NEUTRON_ANALYZER
+#define NEUTRON_ANALYZER PulseShapeAnalyzer
+#endif
+
+/**
+ * @brief The pipeline stages of the sketch, each one selected by its build flag. \struct DefaultPolicies
+ *
+ * A BasicNeutronDetector runs source -> filter -> trigger -> capture -> analyzer -> sinks with the
+ * types given here, all calls resolved at compile time.
+ */
+struct DefaultPolicies
+{
+    static constexpr uint8_t OVERSAMPLE_COUNT = 16;
+
+    using Source = NEUTRON_SOURCE;
+#if NEUTRON_OVERSAMPLE_COMBINER == NEUTRON_COMBINER_MEDIAN3
+    using Filter = Median3Combiner<OVERSAMPLE_COUNT>;
+#elif NEUTRON_OVERSAMPLE_COMBINER == NEUTRON_COMBINER_TRIMMED
+    using Filter = TrimmedCombiner<OVERSAMPLE_COUNT>;
+#elif NEUTRON_OVERSAMPLE_COMBINER == NEUTRON_COMBINER_NONE
+    using Filter = SingleReadCombiner;
+#else
+    using Filter = MeanCombiner<OVERSAMPLE_COUNT>;
+#endif
+    using Trigger = NEUTRON_TRIGGER;
+    using Capture = NEUTRON_CAPTURE;
+    using Analyzer = NEUTRON_ANALYZER;
+    using Sinks = EventSinks<NEUTRON_EVENT_SINKS>;
+};
+
+/**
+ * @brief Class for detecting neutron pulses using an analog input. \class BasicNeutronDetector
+ *
+ * The member definitions live in neutronDetector.cpp and are instantiated there for DefaultPolicies,
+ * a deployment picks its stages through the build flags above.
+ *
+ * @tparam Policies Provides the Source, Filter, Trigger, Capture, Analyzer and Sinks stage types.
+ */
+template <typename Policies>
+class BasicNeutronDetector
 {
+    friend struct NeutronDetectorProbe;     // host tests reach the feature kernels
+    friend typename Policies::Capture;      // reads through the filter stage or the source
+    friend typename Policies::Analyzer;     // runs the feature kernels
+
 public:
 
     static constexpr uint8_t SAMPLES_PER_PULSE = 30;
     static constexpr uint16_t MAX_PULSES = 30;
     static constexpr uint16_t SAMPLE_INTERVAL_US = 10;
+    static constexpr uint32_t DEAD_TIME_US = 2000;      // shortest interval between two triggers
     static constexpr uint16_t OVERSAMPLE_INTERVAL_US = 2;
-    static constexpr uint8_t OVERSAMPLE_COUNT = 16;
+    static constexpr uint8_t OVERSAMPLE_COUNT = Policies::Filter::READS;
+    static constexpr uint8_t PRETRIGGER_SAMPLES = 4;
+    static constexpr uint8_t VETO_RING_SIZE = 16;
+    static constexpr uint32_t DEFAULT_VETO_WINDOW_US = 100;
+    static constexpr uint8_t TOF_BINS = 64;
+    static constexpr uint32_t TOF_BIN_AUTO = 0;
+    static constexpr uint8_t TOF_SPAN_LATENCIES = 8;
+    static constexpr uint32_t TOF_MAX_START_AGE_US = 1000000;
+    static constexpr uint32_t TOF_MAX_BIN_US = TOF_MAX_START_AGE_US / TOF_BINS;
+    static constexpr uint32_t TOF_INVALID = 0xFFFFFFFF;
+    static constexpr uint8_t SPECTRUM_BINS = 64;
+    static constexpr uint8_t ENERGY_BANDS = 4;
+    static constexpr uint32_t CHECKPOINT_INTERVAL_US = 60000000;
+    static constexpr uint16_t STREAM_FRAME_MAX = 1024;          // a pulse with every field at its widest and two 30 point arrays is 913
+    static constexpr uint8_t STREAM_MAX_EVENTS_PER_READ = 16;
+    static constexpr uint32_t STREAM_IDLE_TIMEOUT_US = 10000000;
+    static constexpr uint16_t RESPONSE_SLICE_BYTES = STREAM_FRAME_MAX;    // one pulse object fits a slice
+    static constexpr uint16_t STATS_JSON_RESERVE = 1024;
+    static constexpr float SELFTEST_MIN_ACCURACY = 0.85f;
+    static constexpr float SELFTEST_FEATURE_TOLERANCE = 0.02f;     // relative
+    static constexpr float SELFTEST_FEATURE_ABS_TOLERANCE = 0.01f;
+    static constexpr uint32_t SELFTEST_CYCLE_BUDGET_US = 1000;      // half the minimum capture interval
+    static constexpr uint8_t SELFTEST_REPEATS = 3;
+
+    static constexpr uint8_t PULSE_FLAG_NEUTRON = 0x01;
+    static constexpr uint8_t PULSE_FLAG_VETOED = 0x02;
+    static constexpr uint8_t PULSE_FLAG_PULSER = 0x04;
 
     /**
      * @brief Structure representing a detected neutron pulse. \struct Pulse
@@ -22,10 +145,65 @@ public:
     struct Pulse
     {
         uint64_t timestamp;
+        uint64_t serializedAt;          // device time its stream frame was encoded, 0 if never published
         uint8_t samples[SAMPLES_PER_PULSE];
+        uint16_t sampleTimes[SAMPLES_PER_PULSE];    // measured, in us after the first sample
         uint8_t peakValue;
+        uint8_t flags;
+        uint32_t tofCycles;
+        float baseline;
+        uint8_t neutronProbability;     // Q8, 255 = certain neutron
+        uint16_t captureUs;             // trigger to last sample, saturating
+        uint16_t analysisUs;            // feature extraction and classification, saturating
     };
     
+    /**
+     * @brief Waveform representation used when serializing pulse samples. \enum WaveformView
+     */
+    enum class WaveformView : uint8_t
+    {
+        RAW,        ///< all samples as captured
+        MINMAX,     ///< min/max envelope per bucket
+        LTTB        ///< largest-triangle-three-buckets downsampling
+    };
+
+    /**
+     * @brief Fault injected by the fault injector. \enum FaultMode
+     */
+    enum class FaultMode : uint8_t
+    {
+        NONE,
+        SATURATE,       ///< ADC reads full scale
+        FLOATING,       ///< ADC reads random values like an open input
+        STUCK,          ///< ADC reads a fixed value
+        DROP_CLIENT     ///< HTTP clients are disconnected before the response
+    };
+
+    /**
+     * @brief Pulse features the soft classifier can use. \enum Feature
+     */
+    enum class Feature : uint8_t
+    {
+        DECAY_TIME,
+        RISE_TIME,
+        PULSE_AREA,
+        DECAY_CONSTANT,
+        ZERO_CROSSING_TIME,
+        COUNT
+    };
+
+    static constexpr uint8_t CLASSIFIER_BINS = 16;
+
+    /**
+     * @brief Binned neutron/gamma log-likelihood ratio of one feature. \struct FeatureTable
+     */
+    struct FeatureTable
+    {
+        float min;
+        float binWidth;
+        int8_t llr[CLASSIFIER_BINS];    // ln(p(x|n) / p(x|g)) in 1/16 units, 0 leaves the feature out
+    };
+
     /**
      * @brief Structure representing the analysis of a neutron pulse. \struct PulseAnalysis
      */
@@ -34,24 +212,123 @@ public:
         float decayTime;
         float riseTime;
         float pulseArea;
+        float zeroCrossingTime;
+        float decayConstant;
+        float neutronProbability;
         bool isNeutron;
         float baseline;
         float threshold;
     };
 
+    /**
+     * @brief Outcome of running the analysis over the golden waveform corpus. \struct SelfTestResult
+     */
+    struct SelfTestResult
+    {
+        uint8_t waveforms;
+        uint8_t correct;
+        uint8_t featureMismatches;
+        uint32_t meanCycles;
+        uint32_t maxCycles;
+        bool passed;
+    };
+
     /**
      * @brief Construct a new Neutron Detector object
      * 
      * @param analogPin The analog pin to which the neutron detector is connected.
-     * @param threshold The threshold value for detecting neutron pulses.
+     * @param threshold The trigger level in ADC counts, replaced by baseline + 4 * noise once the noise is measured.
      */
-    NeutronDetector(uint8_t analogPin = A0, uint16_t threshold = 100);
+    BasicNeutronDetector(uint8_t analogPin = A0, uint16_t threshold = 100);
     
     /**
      * @brief Initialize the neutron detector.
      */
     void begin();
 
+    /**
+     * @brief Enable the external veto input for anti-coincidence rejection.
+     * @param vetoPin The digital pin carrying the veto signal (rising edge).
+     * @param windowUs Pulses within +/- windowUs of a veto edge are vetoed.
+     * @param reject true to remove vetoed pulses from the counts, false to only tag them.
+     */
+    void enableVeto(uint8_t vetoPin, uint32_t windowUs = DEFAULT_VETO_WINDOW_US, bool reject = true);
+
+    /**
+     * @brief Enable the external start input for time-of-flight measurement.
+     *
+     * Call before begin() to keep the TOF histogram restored from flash, a later call with another
+     * bin width clears it.
+     * @param startPin The digital pin carrying the source start signal (rising edge).
+     * @param binWidthUs The width of one TOF histogram bin in microseconds, TOF_BIN_AUTO to span
+     *                   TOF_SPAN_LATENCIES trigger latencies, measured here by timing one trigger read.
+     */
+    void enableStartInput(uint8_t startPin, uint32_t binWidthUs = TOF_BIN_AUTO);
+
+    /**
+     * @brief Enable the software pulser forcing captures independent of the signal.
+     *
+     * A tick in the dead time or a blind fault is requested but not recorded like a pulse would be lost,
+     * so live_fraction is the share of time a trigger is taken.
+     * @param periodUs The mean interval between forced triggers in microseconds, 0 disables the pulser.
+     * @param randomIntervals true for exponentially distributed intervals, false for a fixed period.
+     */
+    void enablePulser(uint32_t periodUs, bool randomIntervals = false);
+
+    /**
+     * @brief Set the capture schedule as sample offsets from the trigger.
+     * @param offsetsUs SAMPLES_PER_PULSE strictly increasing offsets in microseconds.
+     * @return true if the schedule was accepted, false otherwise.
+     */
+    bool setSampleSchedule(const uint16_t* offsetsUs);
+
+    /**
+     * @brief Set a schedule that is dense around the trigger and peak and grows geometrically in the tail.
+     * @param denseSamples The number of samples taken at the dense interval.
+     * @param denseIntervalUs The interval of the dense samples in microseconds.
+     * @param growth The factor each tail interval grows by, at least 1, lowered until the last offset fits 16 bits.
+     * @return true if the schedule was accepted, false if even the dense samples do not fit the 16-bit offsets.
+     */
+    bool setGeometricSchedule(uint8_t denseSamples, uint16_t denseIntervalUs, float growth);
+
+    /**
+     * @brief Load a calibrated likelihood ratio table for one classifier feature.
+     * @param feature The feature the table belongs to.
+     * @param table The binned log-likelihood ratios; values outside the range use the edge bins.
+     */
+    void setClassifierTable(Feature feature, const FeatureTable& table);
+
+    /**
+     * @brief Set the prior neutron fraction of the soft classifier.
+     * @param neutronFraction The expected fraction of neutron events, in (0, 1).
+     */
+    void setClassifierPrior(float neutronFraction);
+
+    /**
+     * @brief Set the misclassification rates of an energy band from a calibration run.
+     * @param band The energy band, 0 is the lowest.
+     * @param gammaAsNeutron The fraction of true gammas classified as neutrons.
+     * @param neutronAsGamma The fraction of true neutrons classified as gammas.
+     */
+    void setMisclassification(uint8_t band, float gammaAsNeutron, float neutronAsGamma);
+
+    /**
+     * @brief Configure the Rossi-alpha and shift-register analysis, clears its results.
+     * @param rossiBinUs The width of one Rossi-alpha bin in microseconds.
+     * @param predelayUs The predelay in front of the R+A gate in microseconds.
+     * @param gateUs The width of the R+A and A gates in microseconds.
+     * @param longDelayUs The delay of the A gate in microseconds.
+     * @return false if the Rossi-alpha range or a gate fits inside DEAD_TIME_US, the analysis is unchanged then.
+     */
+    bool configureCorrelation(uint32_t rossiBinUs, uint32_t predelayUs, uint32_t gateUs, uint32_t longDelayUs);
+
+    /**
+     * @brief Configure the Feynman-Y analysis, clears its results.
+     * @param baseGateUs The narrowest gate width in microseconds, the widths double from there.
+     * @return false if the narrowest gate is shorter than DEAD_TIME_US, the analysis is unchanged then.
+     */
+    bool configureFeynman(uint32_t baseGateUs);
+
     /**
      * @brief Check if the detector is initialized.
      * @return true if initialized, false otherwise.
@@ -81,6 +358,26 @@ public:
      */
     const Pulse& getPulse(uint16_t index) const;
 
+    /**
+     * @brief Lease a stored pulse so capture cannot overwrite it while it is being read.
+     * @param index The index of the pulse to lease.
+     * @return int16_t The leased slot, or -1 if the index is out of range.
+     */
+    int16_t leasePulse(uint16_t index);
+
+    /**
+     * @brief Get a leased pulse.
+     * @param slot The slot returned by leasePulse().
+     * @return const Pulse& The Pulse object in the slot, an empty pulse if the slot is out of range.
+     */
+    const Pulse& getLeasedPulse(int16_t slot) const;
+
+    /**
+     * @brief Release a lease taken with leasePulse().
+     * @param slot The slot returned by leasePulse(), -1 is ignored.
+     */
+    void releasePulse(int16_t slot);
+
     /**
      * @brief Get the analysis of a neutron pulse.
      * @param index The index of the pulse to analyze.
@@ -94,6 +391,17 @@ public:
      */
     bool isInputConnected() const;
 
+#if NEUTRON_FAULT_INJECTION
+    /**
+     * @brief Inject a fault for a limited time. ADC faults stop triggering until the input has settled
+     * again, the events lost meanwhile are estimated from the rate before the fault.
+     * @param mode The fault to inject, NONE ends the active fault early.
+     * @param durationMs How long the fault lasts in milliseconds.
+     * @param value The ADC value returned in STUCK mode.
+     */
+    void injectFault(FaultMode mode, uint32_t durationMs, uint16_t value = 0);
+#endif
+
     /**
      * @brief Register HTTP endpoints for the neutron detector.
      * @param server The ESP8266WebServer instance to register endpoints with. 
@@ -102,16 +410,90 @@ public:
 
     /**
      * @brief Get the last captured pulse as a JSON string.
+     * @param view The waveform representation of the samples.
+     * @param points The number of waveform points (buckets for MINMAX).
      * @return String JSON representation of the last pulse.
      */
-    String getLastPulseJSON();
+    String getLastPulseJSON(WaveformView view = WaveformView::RAW, uint8_t points = SAMPLES_PER_PULSE);
 
     /**
      * @brief Get the pulse history as a JSON string.
      * @param count The number of pulses to include in the history (default is 5).
+     * @param view The waveform representation of the samples.
+     * @param points The number of waveform points (buckets for MINMAX).
      * @return String JSON representation of the pulse history.
      */
-    String getPulseHistoryJSON(uint16_t count = 5);
+    String getPulseHistoryJSON(uint16_t count = 5, WaveformView view = WaveformView::RAW, uint8_t points = SAMPLES_PER_PULSE);
+
+    /**
+     * @brief Compute the min/max envelope of a pulse waveform.
+     * @param p The Pulse object to downsample.
+     * @param buckets The number of buckets, clamped to [1, SAMPLES_PER_PULSE].
+     * @param minOut Receives the minimum of every bucket.
+     * @param maxOut Receives the maximum of every bucket.
+     * @return uint8_t The number of buckets written.
+     */
+    uint8_t computeMinMaxEnvelope(const Pulse& p, uint8_t buckets, uint8_t* minOut, uint8_t* maxOut) const;
+
+    /**
+     * @brief Downsample a pulse waveform with largest-triangle-three-buckets.
+     * @param p The Pulse object to downsample.
+     * @param points The number of points, clamped to [2, SAMPLES_PER_PULSE].
+     * @param indexOut Receives the sample index of every selected point.
+     * @param valueOut Receives the sample value of every selected point.
+     * @return uint8_t The number of points written.
+     */
+    uint8_t computeLTTB(const Pulse& p, uint8_t points, uint8_t* indexOut, uint8_t* valueOut) const;
+
+    /**
+     * @brief Get the pulse height spectra per pulse class as a JSON string.
+     * @return String JSON representation of the spectra.
+     */
+    String getSpectrumJSON();
+
+    /**
+     * @brief Get the confusion-matrix corrected neutron and gamma rates as a JSON string.
+     * @return String JSON with observed and unfolded counts and rates per energy band.
+     */
+    String getRatesJSON();
+
+    /**
+     * @brief Get the neutron correlation analysis as a JSON string.
+     * @return String JSON with the Rossi-alpha histogram and the shift-register multiplicities.
+     */
+    String getCorrelationJSON();
+
+    /**
+     * @brief Get the Feynman-Y curve as a JSON string.
+     * @return String JSON with Y(T) and the gate moments per gate width.
+     */
+    String getFeynmanJSON();
+
+    /**
+     * @brief Get the time-of-flight histograms per pulse class as a JSON string.
+     * @return String JSON representation of the TOF histograms.
+     */
+    String getTOFHistogramJSON();
+
+    /**
+     * @brief Get the live event stream from a subscriber cursor as a JSON string.
+     * @param cursor The sequence number of the next event the subscriber wants.
+     * @param maxEvents The maximum number of events to return.
+     * @return String JSON with the pre-encoded events, the next cursor and the skipped count.
+     */
+    String getStreamJSON(uint32_t cursor, uint8_t maxEvents = STREAM_MAX_EVENTS_PER_READ);
+
+    /**
+     * @brief Rerun the golden waveform self-test and report it as a JSON string.
+     * @return String JSON with accuracy, per-pulse cycle cost and every feature outside its tolerance.
+     */
+    String getSelfTestJSON();
+
+    /**
+     * @brief Get the device clock for aligning client receive times with event timestamps.
+     * @return String JSON with the current device time in microseconds.
+     */
+    String getTimeJSON();
 
     /**
      * @brief Get the statistics of the neutron detector as a JSON string.
@@ -125,12 +507,21 @@ private:
     Pulse _pulses[MAX_PULSES];
     uint16_t _writeIndex;
     uint16_t _storedCount;
+    uint8_t _leases[MAX_PULSES] = {};
+    uint32_t _capturesLostToLease = 0;
     
     uint64_t _lastCaptureTime;
-    const uint64_t _minInterval = 2000;
     
+    uint16_t _sampleSchedule[SAMPLES_PER_PULSE];
+    bool _uniformSchedule = true;
+    float _sampleIntervalUs = SAMPLE_INTERVAL_US;   // only tracked for a uniform schedule
+    float _sampleJitterUs = 0;                      // RMS of measured minus scheduled sample offsets
+
     float _baseline = 512.0f;
     float _noiseRMS = 40.0f;
+    uint16_t _preTrigger[PRETRIGGER_SAMPLES] = {};
+    uint8_t _preTriggerIndex = 0;
+    uint8_t _preTriggerCount = 0;
     
     static constexpr uint16_t MAX_RAW_VALUE = 1023;
     static constexpr uint8_t MAX_SAMPLE_VALUE = 255;
@@ -140,27 +531,330 @@ private:
     static constexpr float NEUTRON_AREA_THRESHOLD = 500.0f;
     static constexpr uint8_t BASELINE_DEVIATION_THRESHOLD = 5;
 
+    static constexpr uint8_t DECAY_FIT_MIN_AMPLITUDE = 2;
+    static constexpr uint8_t DECAY_FIT_MIN_POINTS = 3;
+
+    /// @brief log2(x) for 8-bit x in Q12, built at compile time. \struct Log2Table
+    struct Log2Table
+    {
+        uint16_t value[256];
+
+        constexpr Log2Table() : value()
+        {
+            for (uint16_t x = 1; x < 256; ++x)
+            {
+                uint16_t integer = 0;
+                while ((x >> (integer + 1)) != 0) integer++;
+
+                // fractional bits by repeated squaring of the normalized mantissa in Q16
+                uint64_t m = ((uint64_t)x << 16) >> integer;
+                uint16_t fraction = 0;
+                for (uint8_t bit = 0; bit < 12; ++bit)
+                {
+                    m = (m * m) >> 16;
+                    fraction <<= 1;
+                    if (m >= (2ULL << 16))
+                    {
+                        m >>= 1;
+                        fraction |= 1;
+                    }
+                }
+                value[x] = (integer << 12) | fraction;
+            }
+        }
+    };
+
+    static const Log2Table LOG2_Q12;
+
+    // CR-RC-RC shaper for the zero-crossing discriminator, time constants of 2 nominal sample intervals,
+    // the per-step coefficients tau / (tau + dt) and dt / (tau + dt) follow the measured sample times
+    static constexpr int32_t ZC_TAU_US = 2 * SAMPLE_INTERVAL_US;
+
     bool _initialized = false;
     bool _inputConnected = false;
     uint64_t _lastConnectionCheck = 0;
     const uint64_t CONNECTION_CHECK_INTERVAL = 1000000;
 
+    uint32_t _saturatedCaptures = 0;
+    uint32_t _disconnectResets = 0;
+    uint32_t _clientDrops = 0;
+
+#if NEUTRON_FAULT_INJECTION
+    FaultMode _faultMode = FaultMode::NONE;
+    uint16_t _faultValue = 0;
+    uint64_t _faultEnd = 0;
+    uint64_t _faultClearedAt = 0;
+    uint64_t _faultStart = 0;           // start of the ADC fault not yet recovered from, 0 if none
+    float _faultBaseline = 0;
+    uint16_t _faultThreshold = 0;
+    float _faultRateHz = 0;             // counted rate before the fault
+    uint32_t _faultRecoveryUs = 0;      // fault cleared until baseline and threshold are back
+    uint32_t _faultBlindUs = 0;         // fault start until recovery, no event was counted
+    uint64_t _faultBlindTotalUs = 0;    // kept out of the rate reference of later faults
+    uint32_t _faultLostEvents = 0;      // estimated from the rate before each fault and its blind time
+
+    /**
+     * @brief Expire the active fault once its duration has passed.
+     */
+    void updateFault();
+
+    /**
+     * @brief Check whether an ADC fault is active or the input has not settled since it cleared, and
+     * account for the lost events once it has.
+     * @param now The current time from micros64().
+     * @return true while readings must not be used for triggering.
+     */
+    bool isFaultBlinded(uint64_t now);
+#endif
+
+    uint32_t _pulserPeriodUs = 0;
+    bool _pulserRandom = false;
+    uint64_t _nextPulserTime = 0;
+    uint32_t _pulserRequested = 0;
+    uint32_t _pulserRecorded = 0;
+    float _pulserBaseline = 0;
+    float _pulserNoiseRMS = 0;
+
+    /**
+     * @brief Get the interval to the next forced trigger.
+     * @return uint32_t The interval in microseconds.
+     */
+    uint32_t nextPulserInterval() const;
+
+    /**
+     * @brief Update the baseline and noise snapshot from a pulser trace.
+     * @param p The forced Pulse object.
+     */
+    void updatePulserSnapshot(const Pulse& p);
+
     uint32_t _totalPulses = 0;
     uint32_t _neutronCount = 0;
+    uint64_t _neutronExpectedQ8 = 0;          // sum of the stored Q8 neutron probabilities
+    uint64_t _neutronClassVarianceQ16 = 0;    // sum of p(1 - p) with p in Q8, scaled by 255^2
     uint64_t _lastNeutronTime = 0;
     float _maxPulseArea = 0;
     float _maxDecayTime = 0;
 
+    FeatureTable _classifier[(uint8_t)Feature::COUNT];
+    float _classifierPriorLogit = 0;
+    bool _classifierCalibrated = false;
+    SelfTestResult _selfTest = {};
+
+    /**
+     * @brief Fill a classifier table with a smooth step around a hard-rule threshold.
+     * @param feature The feature to initialize.
+     * @param threshold The hard-rule threshold of the feature.
+     * @param binWidth The width of one bin in feature units.
+     */
+    void initClassifierStep(Feature feature, float threshold, float binWidth);
+
+    /**
+     * @brief Compute the neutron probability of an analyzed pulse.
+     * @param a The analysis with all features filled in.
+     * @return float The calibrated neutron probability.
+     */
+    float classify(const PulseAnalysis& a) const;
+
+    bool _vetoEnabled = false;
+    bool _vetoReject = true;
+    uint8_t _vetoPin = 0;
+    uint32_t _vetoWindowUs = DEFAULT_VETO_WINDOW_US;
+    volatile uint32_t _vetoTimes[VETO_RING_SIZE];
+    volatile uint32_t _vetoHead = 0;
+    uint32_t _vetoTail = 0;
+    uint32_t _lastVetoTime = 0;
+    uint32_t _vetoDeadEnd = 0;
+    uint64_t _vetoEnabledAt = 0;
+    uint64_t _vetoDeadTimeUs = 0;
+    uint32_t _vetoCount = 0;
+    uint32_t _vetoRejected = 0;
+    uint32_t _vetoTagged = 0;
+    uint32_t _vetoOverruns = 0;
+
+    uint32_t _spectrum[2][SPECTRUM_BINS] = {};    // [0] gamma, [1] neutron
+    const uint8_t _bandEdges[ENERGY_BANDS - 1] = { 16, 48, 112 };    // pulse height, multiples of the spectrum bin width
+    float _gammaAsNeutron[ENERGY_BANDS] = {};
+    float _neutronAsGamma[ENERGY_BANDS] = {};
+    uint64_t _startTime = 0;
+    uint32_t _measuredSeconds = 0;      // checkpointed with the spectra, includes earlier runs
+    uint32_t _restoredSeconds = 0;
+    int8_t _timeRegion = -1;
+
+    using Sinks = typename Policies::Sinks;
+    Sinks _sinks;
+    typename Policies::Trigger _trigger;
+    HistogramJournal _journal;
+    int8_t _spectrumRegion = -1;
+    int8_t _tofRegion = -1;
+    uint64_t _lastCheckpoint = 0;
+
+    uint32_t _pulseSeq = 0;     // pulses committed so far, the newest stored pulse is _pulseSeq - 1
+    uint32_t _maxSliceUs = 0;
+
+    /**
+     * @brief State of a response that is serialized in slices between acquisition steps. \struct ResponseSlicer
+     */
+    struct ResponseSlicer
+    {
+        enum class Kind : uint8_t { HISTORY, SPECTRUM, TOF, TRACE, TRACE_RAW };
+
+        Kind kind;
+        uint8_t phase;              // 0 header, 1 first array, 2 second array, 3 footer, 4 done
+        uint16_t index;             // next bin of the current array
+        uint16_t count;             // history: requested number of pulses
+        uint32_t next;              // history: sequence number of the next pulse
+        uint32_t end;               // history: sequence number after the last pulse
+        uint16_t emitted;           // history: pulses written so far
+        int16_t slot;               // history: leased slot of the next pulse, all up to end stay leased
+        WaveformView view;
+        uint8_t points;
+#if NEUTRON_TRACE
+        StageTrace::Cursor trace;   // trace: export position, recording is paused until the response ends
+#endif
+    };
+
+    /**
+     * @brief Append the next slice of a response, at most RESPONSE_SLICE_BYTES.
+     * @param s The slicer state, advanced past the appended slice.
+     * @param out The string the slice is appended to.
+     * @return true if more slices follow, false once the response is complete.
+     */
+    bool nextSlice(ResponseSlicer& s, String& out);
+
+    /**
+     * @brief Append the next pulse of a history response.
+     * @param s The slicer state.
+     * @param out The string the pulse is appended to.
+     */
+    void sliceHistoryPulse(ResponseSlicer& s, String& out);
+
+    /**
+     * @brief Release the pulses a history response still holds, for a response that ends early.
+     * @param s The slicer state.
+     */
+    void releaseSlicer(ResponseSlicer& s);
+
+    /**
+     * @brief Append the next bins of a two-class histogram response.
+     * @param s The slicer state.
+     * @param out The string the bins are appended to.
+     * @param bins The bins of the class the current array belongs to.
+     * @param count The number of bins.
+     */
+    void sliceHistogram(ResponseSlicer& s, String& out, const uint32_t* bins, uint8_t count);
+
+    /**
+     * @brief Send a response slice by slice, running acquisition between the slices.
+     * @param server The ESP8266WebServer instance holding the request.
+     * @param s The slicer state of the response.
+     */
+    void sendSliced(ESP8266WebServer& server, ResponseSlicer& s);
+
+    FrameRing _stream;
+    uint64_t _lastStreamRead = 0;
+    bool _streamActive = false;
+    uint32_t _streamSkipped = 0;
+    uint32_t _streamDropped = 0;
+
+    /**
+     * @brief Serialize the newest pulse once into the shared stream ring.
+     * @param analysis The analysis capturePulse() already made of the pulse, nullptr to analyze it here.
+     */
+    void publishLastPulse(const PulseAnalysis* analysis = nullptr);
+
+    bool _tofEnabled = false;
+    uint8_t _startPin = 0;
+    uint32_t _tofBinCycles = 0;
+    uint8_t _cyclesPerUs = 80;
+    volatile uint32_t _startCycles = 0;
+    volatile uint32_t _startMicros = 0;
+    volatile uint32_t _startCount = 0;
+    uint32_t _tofHistogram[2][TOF_BINS] = {};    // [0] gamma, [1] neutron
+    uint32_t _tofOverflow = 0;
+    uint32_t _tofStaleStarts = 0;
+    uint32_t _triggerLatencyUs = 0;
+
+    /**
+     * @brief Interrupt handler timestamping a start edge with the CPU cycle counter.
+     * @param arg The NeutronDetector instance.
+     */
+    static void startISR(void* arg);    // IRAM_ATTR on the definition only, it names a section per line
+
+    /**
+     * @brief Get the time of flight relative to the most recent start edge.
+     * @param cycles The CPU cycle count of the event.
+     * @return uint32_t The time of flight in CPU cycles, or TOF_INVALID if no start was seen.
+     */
+    uint32_t computeTimeOfFlight(uint32_t cycles) const;
+
+    /**
+     * @brief Forget a start edge older than TOF_MAX_START_AGE_US, before the cycle counter can alias.
+     */
+    void expireStaleStart();
+
+    /**
+     * @brief Sum the spectrum of both classes per energy band.
+     * @param counts Receives the counts, [band][0] gamma and [band][1] neutron.
+     */
+    void computeBandCounts(uint32_t counts[ENERGY_BANDS][2]) const;
+
+    /**
+     * @brief Add or remove a pulse from the spectrum and TOF histogram of its class.
+     * @param p The Pulse object to account.
+     * @param delta +1 to add the pulse, -1 to remove it.
+     */
+    void accountHistograms(const Pulse& p, int8_t delta);
+
+    /**
+     * @brief Interrupt handler timestamping a veto edge into the veto ring.
+     * @param arg The NeutronDetector instance.
+     */
+    static void vetoISR(void* arg);     // IRAM_ATTR on the definition only, it names a section per line
+
+    /**
+     * @brief Merge new veto timestamps with the stored pulses and veto the coincident ones.
+     */
+    void processVetoes();
+
+    /**
+     * @brief Check a timestamp against the last processed veto edge.
+     * @param timestamp The timestamp to check in microseconds.
+     * @return true if the timestamp lies inside the veto window, false otherwise.
+     */
+    bool isVetoed(uint32_t timestamp) const;
+
+    /**
+     * @brief Mark a stored pulse as vetoed and remove it from the counts if rejecting.
+     * @param p The Pulse object to veto.
+     */
+    void vetoPulse(Pulse& p);
+
     /**
      * @brief Capture a neutron pulse.
+     * @param forced true for a pulser trigger, which is kept out of the physics counts.
+     * @return true if the pulse was stored, false if the capture was lost.
      */
-    void capturePulse();
+    bool capturePulse(bool forced = false);
 
     /**
      * @brief Update the baseline noise level.
      */
     void updateBaseline();
 
+    /**
+     * @brief Estimate the local baseline of a pulse from the pre-trigger readings.
+     * @return float The baseline in 8-bit sample units.
+     */
+    float computeLocalBaseline() const;
+
+    /**
+     * @brief Read the analog input, with the injected fault applied if enabled.
+     * @return uint16_t The raw 10-bit reading.
+     */
+    uint16_t readADC();
+
+    using Combiner = typename Policies::Filter;
+
     /**
      * @brief Perform oversampling to improve signal quality.
      * @param active The state of oversampling (true for active, false for inactive).
@@ -175,6 +869,38 @@ private:
      */
     float computeDecayTime(const Pulse& p) const;
 
+    /**
+     * @brief Interpolate the time a pulse crosses a level between two samples.
+     * @param p The Pulse object to analyze.
+     * @param i The first sample past the crossing.
+     * @param level The level in 8-bit sample units.
+     * @return float The crossing time in microseconds after the first sample.
+     */
+    float interpolateCrossing(const Pulse& p, uint8_t i, float level) const;
+
+    /**
+     * @brief Compute the mean measured sample interval of a pulse.
+     * @param p The Pulse object to analyze.
+     * @return float The mean sample interval in microseconds.
+     */
+    float computeSampleInterval(const Pulse& p) const;
+
+    /**
+     * @brief Update the achieved sample rate and jitter statistics from a capture.
+     * @param p The captured Pulse object.
+     */
+    void updateSampleClock(const Pulse& p);
+
+    /**
+     * @brief The offset of one sample in a geometric schedule.
+     * @param index The sample index.
+     * @param denseSamples The number of samples taken at the dense interval.
+     * @param denseIntervalUs The interval of the dense samples in microseconds.
+     * @param growth The factor each tail interval grows by.
+     * @return double The offset in microseconds, not limited to 16 bits.
+     */
+    static double geometricOffset(uint8_t index, uint8_t denseSamples, uint16_t denseIntervalUs, float growth);
+
     /**
      * @brief Compute the area under the pulse curve.
      * @param p The Pulse object to analyze.
@@ -189,6 +915,20 @@ private:
      */
     float computeRiseTime(const Pulse& p) const;
 
+    /**
+     * @brief Compute the zero-crossing time of the CR-RC-RC shaped pulse, valid for any sample schedule.
+     * @param p The Pulse object to analyze.
+     * @return float The zero-crossing time in microseconds after the first sample, or -1 if none.
+     */
+    float computeZeroCrossingTime(const Pulse& p) const;
+
+    /**
+     * @brief Estimate the tail decay constant by a weighted log-linear least squares fit.
+     * @param p The Pulse object to analyze.
+     * @return float The decay constant in microseconds, or -1 if the tail is too short to fit.
+     */
+    float computeDecayConstant(const Pulse& p) const;
+
     /**
      * @brief Update the threshold for pulse detection.
      * @param currentDev The current deviation from the baseline.
@@ -202,6 +942,13 @@ private:
      */
     PulseAnalysis analyzePulse(const Pulse& p) const;
 
+    /**
+     * @brief Run the analysis over the golden corpus and check accuracy, features and cycle cost.
+     * @param mismatches Receives one object per feature outside its tolerance, may be nullptr.
+     * @return SelfTestResult The outcome, also kept for the statistics.
+     */
+    SelfTestResult runSelfTest(JsonArray* mismatches = nullptr);
+
     /**
      * @brief Check if the input is connected.
      * @return true if the input is connected, false otherwise.
@@ -209,11 +956,47 @@ private:
     bool checkInputConnected();
 
     /**
-     * @brief Add a pulse to the JSON document.
-     * @param doc The JSON document to which the pulse data will be added.
-     * @param index The index of the pulse to add.
+     * @brief Encode a pulse as a JSON object straight into a buffer.
+     * @param buffer The output buffer.
+     * @param size The size of the buffer in bytes.
+     * @param pulse The pulse to encode.
+     * @param view The waveform representation of the samples.
+     * @param points The number of waveform points (buckets for MINMAX).
+     * @param serializedAt Set when publishing: receives the serialization time, which is taken at the end of the
+     *                     encoding. Without it the time stored in the pulse at publication is written, if any.
+     * @param analysis The analysis of the pulse if the caller has it, nullptr to analyze the pulse here.
+     * @return size_t The length of the JSON object, 0 if it does not fit the buffer.
      */
-    void addPulseToJSON(JsonDocument& doc, uint16_t index) const;
+    size_t encodePulse(char* buffer, size_t size, const Pulse& pulse, WaveformView view = WaveformView::RAW,
+                       uint8_t points = SAMPLES_PER_PULSE, uint64_t* serializedAt = nullptr,
+                       const PulseAnalysis* analysis = nullptr);
+
+    /**
+     * @brief Check that the requesting client is still there, counting it as dropped otherwise.
+     * @param server The ESP8266WebServer instance holding the request.
+     * @return true if the response can be sent.
+     */
+    bool checkClient(ESP8266WebServer& server);
+
+    /**
+     * @brief Send a JSON response, skipping clients that disconnected in the meantime.
+     * @param server The ESP8266WebServer instance holding the request.
+     * @param body The JSON response body.
+     */
+    void sendJSON(ESP8266WebServer& server, const String& body);
+
+    /**
+     * @brief Parse the waveform view query arguments of a request.
+     * @param server The ESP8266WebServer instance holding the request.
+     * @param view Receives the requested waveform view.
+     * @param points Receives the requested number of points.
+     */
+    static void parseWaveformViewArgs(ESP8266WebServer& server, WaveformView& view, uint8_t& points);
 };
 
+extern template class BasicNeutronDetector<DefaultPolicies>;
+
+/// @brief The detector of the sketch, with the stages selected by the build flags.
+using NeutronDetector = BasicNeutronDetector<DefaultPolicies>;
+
 #endif // NEUTRON_DETECTOR_H
\ No newline at end of file
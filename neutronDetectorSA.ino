@@ -3,6 +3,11 @@
 NeutronDetector detector(A0);
 ESP8266WebServer server(80);
 
+#if NEUTRON_TRACE
+WiFiEventHandler stationConnectedHandler;
+WiFiEventHandler stationDisconnectedHandler;
+#endif
+
 void setup()
 {
     Serial.begin(115200);
@@ -15,7 +20,27 @@ void setup()
     WiFi.softAPConfig(local_IP, gateway, subnet);
     WiFi.softAP("NeutronDetector", "admin");
 
+#if NEUTRON_TRACE
+    stationConnectedHandler = WiFi.onSoftAPModeStationConnected([](const WiFiEventSoftAPModeStationConnected&)
+    {
+        TRACE_INSTANT(TraceStage::WIFI);
+    });
+    stationDisconnectedHandler = WiFi.onSoftAPModeStationDisconnected([](const WiFiEventSoftAPModeStationDisconnected&)
+    {
+        TRACE_INSTANT(TraceStage::WIFI);
+    });
+#endif
+
+#if NEUTRON_START_INPUT
+    // TOF start: 3.3 V rising edge on D6 (GPIO12), pull it down externally with 10k to GND
+    detector.enableStartInput(D6);
+#endif
     detector.begin();
+#if NEUTRON_VETO
+    // veto: 3.3 V rising edge on D5 (GPIO14), which has no internal pull-down, so the input needs an
+    // external 10k to GND or an actively driven line, a floating pin vetoes real pulses on noise
+    detector.enableVeto(D5);
+#endif
     detector.registerHTTPEndpoints(server);
     server.begin();
 
@@ -28,6 +53,18 @@ void setup()
 void loop()
 {
     detector.update();
+
+    TRACE_BEGIN(TraceStage::HANDLE_CLIENT);
     server.handleClient();
+    TRACE_END(TraceStage::HANDLE_CLIENT);
+
+#if NEUTRON_TRACE
+    if (Serial.available() && Serial.read() == 't')
+    {
+        StageTrace::writeChromeJSON(Serial);
+        Serial.println();
+    }
+#endif
+
     delayMicroseconds(100);
 }
\ No newline at end of file
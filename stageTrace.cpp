@@ -0,0 +1,117 @@
+#include "stageTrace.h"
+
+#if NEUTRON_TRACE
+
+StageTrace::Record StageTrace::_ring[StageTrace::RING_SIZE];
+uint32_t StageTrace::_head = 0;
+bool StageTrace::_paused = false;
+
+void StageTrace::writeChromeJSON(Print& out)
+{
+    Cursor cursor = open();
+    String piece;
+    bool more = true;
+    while (more)
+    {
+        piece = "";
+        more = writeChromeJSON(piece, cursor, 512);
+        out.print(piece);
+    }
+    close();
+}
+
+StageTrace::Cursor StageTrace::open()
+{
+    _paused = true;
+
+    Cursor c = {};
+    c.end = _head;
+    c.first = c.end > RING_SIZE ? c.end - RING_SIZE : 0;
+    c.next = c.first;
+    c.base = _ring[c.first & (RING_SIZE - 1)].cycles;
+    c.previous = c.base;
+    return c;
+}
+
+bool StageTrace::writeChromeJSON(String& out, Cursor& cursor, size_t maxBytes)
+{
+    static const char* const STAGE_NAMES[(uint8_t)TraceStage::COUNT] = {
+        "acquisition", "analysis", "serialization", "transport", "handle_client", "wifi"
+    };
+
+    const uint8_t cyclesPerUs = ESP.getCpuFreqMHz();
+    const size_t limit = out.length() + maxBytes;
+    char event[EVENT_MAX_BYTES];
+
+    if (!cursor.started) out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    cursor.started = true;
+
+    // the cycle counter wraps every few tens of seconds, records are in order so it can be unwrapped
+    while (cursor.next != cursor.end && out.length() + EVENT_MAX_BYTES <= limit)
+    {
+        const Record& r = _ring[cursor.next & (RING_SIZE - 1)];
+        if (r.cycles < cursor.previous) cursor.offset += 1ULL << 32;
+        cursor.previous = r.cycles;
+
+        const uint64_t cycles = cursor.offset + r.cycles - cursor.base;
+        const uint8_t stage = r.stage < (uint8_t)TraceStage::COUNT ? r.stage : 0;
+
+        int length = snprintf(event, sizeof(event), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu.%03lu,\"pid\":1,\"tid\":1%s}",
+                              cursor.next != cursor.first ? "," : "", STAGE_NAMES[stage], r.phase,
+                              (unsigned long)(cycles / cyclesPerUs),
+                              (unsigned long)((cycles % cyclesPerUs) * 1000 / cyclesPerUs),
+                              r.phase == 'i' ? ",\"s\":\"t\"" : "");
+        out.concat(event, min((size_t)length, sizeof(event) - 1));
+        cursor.next++;
+    }
+
+    if (cursor.next != cursor.end) return true;
+    out += "]}";
+    return false;
+}
+
+bool StageTrace::writeRaw(String& out, Cursor& cursor, size_t maxBytes)
+{
+    const size_t limit = out.length() + maxBytes;
+    char bytes[RAW_HEADER_BYTES];
+
+    if (!cursor.started)
+    {
+        const uint16_t count = cursor.end - cursor.first;
+        memcpy(bytes, RAW_MAGIC, sizeof(RAW_MAGIC));
+        bytes[4] = RAW_VERSION;
+        bytes[5] = ESP.getCpuFreqMHz();
+        bytes[6] = count & 0xFF;
+        bytes[7] = count >> 8;
+        out.concat(bytes, RAW_HEADER_BYTES);
+    }
+    cursor.started = true;
+
+    // the records as they are in the ring, the converter unwraps the cycle counter and names the stages
+    while (cursor.next != cursor.end && out.length() + RAW_RECORD_BYTES <= limit)
+    {
+        const Record& r = _ring[cursor.next & (RING_SIZE - 1)];
+        bytes[0] = r.cycles & 0xFF;
+        bytes[1] = (r.cycles >> 8) & 0xFF;
+        bytes[2] = (r.cycles >> 16) & 0xFF;
+        bytes[3] = r.cycles >> 24;
+        bytes[4] = r.stage;
+        bytes[5] = r.phase;
+        out.concat(bytes, RAW_RECORD_BYTES);
+        cursor.next++;
+    }
+
+    return cursor.next != cursor.end;
+}
+
+void StageTrace::close()
+{
+    _paused = false;
+}
+
+void StageTrace::clear()
+{
+    _head = 0;
+}
+
+#endif // NEUTRON_TRACE
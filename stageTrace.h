@@ -0,0 +1,148 @@
+#ifndef STAGE_TRACE_H
+#define STAGE_TRACE_H
+
+#include <Arduino.h>
+
+/// Build with -DNEUTRON_TRACE=1 to record stage begin/end timestamps, the macros compile to nothing otherwise
+#ifndef NEUTRON_TRACE
+#define NEUTRON_TRACE 0
+#endif
+
+/**
+ * @brief Pipeline stages recorded in the trace. \enum TraceStage
+ */
+enum class TraceStage : uint8_t
+{
+    ACQUISITION,
+    ANALYSIS,
+    SERIALIZATION,
+    TRANSPORT,
+    HANDLE_CLIENT,
+    WIFI,
+    COUNT
+};
+
+#if NEUTRON_TRACE
+
+/// @brief Fixed-size ring of stage begin/end cycle timestamps, exported in Chrome trace format. \class StageTrace
+class StageTrace
+{
+public:
+
+    static constexpr uint16_t RING_SIZE = 256;
+    static constexpr uint8_t EVENT_MAX_BYTES = 96;     // one event with its separator, the longest name and a 53 s timestamp
+    static constexpr char RAW_MAGIC[4] = { 'N', 'T', 'R', 'C' };
+    static constexpr uint8_t RAW_VERSION = 1;
+    static constexpr uint8_t RAW_HEADER_BYTES = 8;
+    static constexpr uint8_t RAW_RECORD_BYTES = 6;
+
+    /// @brief Position of a trace export written in pieces, see open(). \struct Cursor
+    struct Cursor
+    {
+        uint32_t first;
+        uint32_t next;
+        uint32_t end;
+        uint32_t base;          // cycle count of the first event
+        uint32_t previous;      // cycle count of the last event written, to unwrap the counter
+        uint64_t offset;
+        bool started;           // the opening brackets are written
+    };
+
+    /**
+     * @brief Record a stage event with the current CPU cycle count, nothing while an export is open.
+     * @param stage The stage the event belongs to.
+     * @param phase The Chrome trace phase, 'B' begin, 'E' end or 'i' instant.
+     */
+    static inline void record(TraceStage stage, char phase)
+    {
+        if (_paused) return;
+        Record& r = _ring[_head & (RING_SIZE - 1)];
+        r.cycles = ESP.getCycleCount();
+        r.stage = (uint8_t)stage;
+        r.phase = phase;
+        _head++;
+    }
+
+    /**
+     * @brief Write the recorded events as Chrome/Perfetto trace JSON.
+     * @param out The destination, e.g. Serial.
+     */
+    static void writeChromeJSON(Print& out);
+
+    /**
+     * @brief Start an export in pieces, recording pauses until close() so the ring is not overwritten meanwhile.
+     * @return Cursor The position before the first event.
+     */
+    static Cursor open();
+
+    /**
+     * @brief Append the next piece of the Chrome/Perfetto trace JSON of an open export.
+     * @param out The string the piece is appended to.
+     * @param cursor The export position, advanced past the piece.
+     * @param maxBytes The size limit of the piece, at least EVENT_MAX_BYTES.
+     * @return true if more pieces follow, false once the JSON is complete.
+     */
+    static bool writeChromeJSON(String& out, Cursor& cursor, size_t maxBytes);
+
+    /**
+     * @brief Append the next piece of the raw binary dump of an open export, for tools/traceToChrome.py.
+     *
+     * An 8 byte header, the RAW_MAGIC bytes, RAW_VERSION, the CPU clock in MHz and the record count as
+     * uint16, then RAW_RECORD_BYTES per record: the cycle count as uint32, the stage and the phase.
+     * Little endian, the counter is left wrapped.
+     * @param out The string the piece is appended to.
+     * @param cursor The export position, advanced past the piece.
+     * @param maxBytes The size limit of the piece, at least RAW_HEADER_BYTES + RAW_RECORD_BYTES.
+     * @return true if more pieces follow, false once the dump is complete.
+     */
+    static bool writeRaw(String& out, Cursor& cursor, size_t maxBytes);
+
+    /**
+     * @brief End an export and resume recording, harmless without one.
+     */
+    static void close();
+
+    /**
+     * @brief Drop all recorded events.
+     */
+    static void clear();
+
+    /// @brief Records the begin of a stage on construction and its end on destruction. \class Scope
+    class Scope
+    {
+    public:
+        explicit Scope(TraceStage stage) : _stage(stage) { record(_stage, 'B'); }
+        ~Scope() { record(_stage, 'E'); }
+
+    private:
+        TraceStage _stage;
+    };
+
+private:
+    struct Record
+    {
+        uint32_t cycles;
+        uint8_t stage;
+        char phase;
+    };
+
+    static Record _ring[RING_SIZE];
+    static uint32_t _head;
+    static bool _paused;
+};
+
+#define TRACE_BEGIN(stage) StageTrace::record(stage, 'B')
+#define TRACE_END(stage) StageTrace::record(stage, 'E')
+#define TRACE_INSTANT(stage) StageTrace::record(stage, 'i')
+#define TRACE_SCOPE(stage) StageTrace::Scope _traceScope(stage)
+
+#else
+
+#define TRACE_BEGIN(stage) ((void)0)
+#define TRACE_END(stage) ((void)0)
+#define TRACE_INSTANT(stage) ((void)0)
+#define TRACE_SCOPE(stage) ((void)0)
+
+#endif // NEUTRON_TRACE
+
+#endif // STAGE_TRACE_H
@@ -0,0 +1,327 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/// @brief Reaches the private feature kernels of the detector, declared a friend in neutronDetector.h.
+struct NeutronDetectorProbe
+{
+    static float zeroCrossingTime(const NeutronDetector& d, const NeutronDetector::Pulse& p)
+    {
+        return d.computeZeroCrossingTime(p);
+    }
+
+    static double geometricOffset(uint8_t index, uint8_t denseSamples, uint16_t denseIntervalUs, float growth)
+    {
+        return NeutronDetector::geometricOffset(index, denseSamples, denseIntervalUs, growth);
+    }
+
+    static uint8_t lttb(const NeutronDetector& d, const NeutronDetector::Pulse& p, uint8_t points, uint8_t* index, uint8_t* value)
+    {
+        return d.computeLTTB(p, points, index, value);
+    }
+
+    static size_t encode(NeutronDetector& d, char* buffer, size_t size, const NeutronDetector::Pulse& p,
+                         NeutronDetector::WaveformView view, const NeutronDetector::PulseAnalysis& a)
+    {
+        return d.encodePulse(buffer, size, p, view, NeutronDetector::SAMPLES_PER_PULSE, nullptr, &a);
+    }
+};
+
+namespace
+{
+
+constexpr int PULSES_PER_CLASS = 2000;
+
+/// @brief Pulses of one class captured on one schedule, the same seed gives the same analog pulses.
+struct PulseSet
+{
+    std::vector<NeutronDetector::Pulse> neutrons;
+    std::vector<NeutronDetector::Pulse> gammas;
+};
+
+/**
+ * @brief Sample NE213 pulses the way capturePulse() stores them, 10-bit readings cut to 8 bits.
+ * @param offsets The sample schedule in microseconds after the trigger.
+ * @param seed Seeds amplitude, trigger phase and noise.
+ */
+PulseSet capture(const uint16_t* offsets, uint32_t seed)
+{
+    PulseSource::Config config;
+    config.rateHz = 0;
+    PulseSource source(config, 0);
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0, config.noiseRms);
+
+    PulseSet set;
+    for (int n = 0; n < 2 * PULSES_PER_CLASS; ++n)
+    {
+        const bool neutron = n % 2 == 0;
+        PulseSource::Event e = { 0, neutron, std::uniform_real_distribution<double>(200, 700)(random) };
+        // the trigger sees the pulse somewhere on its leading edge
+        const double trigger = std::uniform_real_distribution<double>(0, neutron ? 5.0 : 1.0)(random);
+
+        NeutronDetector::Pulse p = {};
+        p.baseline = config.baseline / 4;
+        for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE; ++i)
+        {
+            const long raw = lround(config.baseline + noise(random) + source.shape(e, trigger + offsets[i]));
+            p.samples[i] = std::min(1023L, std::max(0L, raw)) >> 2;
+            p.sampleTimes[i] = offsets[i];
+        }
+        (neutron ? set.neutrons : set.gammas).push_back(p);
+    }
+    return set;
+}
+
+/// @brief Reference discriminator: the tail integral after the peak over the total integral.
+float chargeRatio(const NeutronDetector::Pulse& p)
+{
+    constexpr float TAIL_START_US = 20;
+    uint8_t peak = 0;
+    for (uint8_t i = 1; i < NeutronDetector::SAMPLES_PER_PULSE; ++i)
+    {
+        if (p.samples[i] > p.samples[peak]) peak = i;
+    }
+
+    float total = 0;
+    float tail = 0;
+    for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE - 1; ++i)
+    {
+        const float area = ((p.samples[i] + p.samples[i + 1]) * 0.5f - p.baseline) * (p.sampleTimes[i + 1] - p.sampleTimes[i]);
+        total += area;
+        if (p.sampleTimes[i] >= p.sampleTimes[peak] + TAIL_START_US) tail += area;
+    }
+    return total > 0 ? tail / total : 0;
+}
+
+struct Separation
+{
+    double neutronMean;
+    double gammaMean;
+    double fom;             // peak distance over the sum of the FWHMs
+    double missing;         // fraction of pulses without a value
+};
+
+template <typename Feature>
+Separation separate(const PulseSet& set, Feature feature)
+{
+    auto stats = [&feature](const std::vector<NeutronDetector::Pulse>& pulses, double& mean, double& sigma, int& missing)
+    {
+        double sum = 0;
+        double sum2 = 0;
+        int n = 0;
+        for (const NeutronDetector::Pulse& p : pulses)
+        {
+            const double v = feature(p);
+            if (v < 0)
+            {
+                missing++;
+                continue;
+            }
+            sum += v;
+            sum2 += v * v;
+            n++;
+        }
+        mean = n ? sum / n : 0;
+        sigma = n ? sqrt(std::max(0.0, sum2 / n - mean * mean)) : 0;
+    };
+
+    double neutronSigma;
+    double gammaSigma;
+    int missing = 0;
+    Separation s;
+    stats(set.neutrons, s.neutronMean, neutronSigma, missing);
+    stats(set.gammas, s.gammaMean, gammaSigma, missing);
+    s.fom = fabs(s.neutronMean - s.gammaMean) / (2.355 * (neutronSigma + gammaSigma));
+    s.missing = missing / (2.0 * PULSES_PER_CLASS);
+    return s;
+}
+
+/// @brief Wall time per call in nanoseconds, best of a few rounds.
+template <typename Feature>
+double nsPerCall(const PulseSet& set, Feature feature)
+{
+    double best = 1e30;
+    volatile float sink = 0;
+    for (int round = 0; round < 5; ++round)
+    {
+        const uint64_t start = host::wallNs();
+        for (const NeutronDetector::Pulse& p : set.neutrons) sink = sink + feature(p);
+        for (const NeutronDetector::Pulse& p : set.gammas) sink = sink + feature(p);
+        best = std::min(best, (host::wallNs() - start) / (2.0 * PULSES_PER_CLASS));
+    }
+    return best;
+}
+
+}
+
+HOST_TEST(zeroCrossingSeparatesOnAnySchedule)
+{
+    host::reset(1000, 1);
+    NeutronDetector detector(A0);
+    auto zc = [&detector](const NeutronDetector::Pulse& p) { return NeutronDetectorProbe::zeroCrossingTime(detector, p); };
+
+    uint16_t uniform[NeutronDetector::SAMPLES_PER_PULSE];
+    uint16_t geometric[NeutronDetector::SAMPLES_PER_PULSE];
+    for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE; ++i)
+    {
+        uniform[i] = i * NeutronDetector::SAMPLE_INTERVAL_US;
+        geometric[i] = lround(NeutronDetectorProbe::geometricOffset(i, 6, NeutronDetector::SAMPLE_INTERVAL_US, 1.15f));
+    }
+
+    // the same analog pulses on both schedules
+    const PulseSet onUniform = capture(uniform, 31);
+    const PulseSet onGeometric = capture(geometric, 31);
+
+    const Separation zcUniform = separate(onUniform, zc);
+    const Separation zcGeometric = separate(onGeometric, zc);
+    const Separation ccUniform = separate(onUniform, chargeRatio);
+    const Separation ccGeometric = separate(onGeometric, chargeRatio);
+    const double zcNs = nsPerCall(onUniform, zc);
+    const double ccNs = nsPerCall(onUniform, chargeRatio);
+
+    REPORT("zero crossing, uniform:   n %.1f us, g %.1f us, FOM %.2f, %.1f%% without a crossing\n",
+           zcUniform.neutronMean, zcUniform.gammaMean, zcUniform.fom, 100 * zcUniform.missing);
+    REPORT("zero crossing, geometric: n %.1f us, g %.1f us, FOM %.2f, %.1f%% without a crossing\n",
+           zcGeometric.neutronMean, zcGeometric.gammaMean, zcGeometric.fom, 100 * zcGeometric.missing);
+    REPORT("charge ratio,  uniform:   n %.3f, g %.3f, FOM %.2f\n", ccUniform.neutronMean, ccUniform.gammaMean, ccUniform.fom);
+    REPORT("charge ratio,  geometric: n %.3f, g %.3f, FOM %.2f\n", ccGeometric.neutronMean, ccGeometric.gammaMean, ccGeometric.fom);
+    REPORT("host cost: zero crossing %.0f ns, charge ratio %.0f ns per pulse\n", zcNs, ccNs);
+
+    // neutrons cross later and both classes are told apart as well as by charge comparison
+    CHECK(zcUniform.neutronMean > zcUniform.gammaMean);
+    CHECK(zcUniform.missing < 0.01);
+    CHECK(zcUniform.fom > 1.0);
+    CHECK(zcUniform.fom > 0.8 * ccUniform.fom);
+
+    // the shaper follows the measured sample times, the longer tail steps do not move the crossing
+    CHECK(zcGeometric.missing < 0.01);
+    CHECK(zcGeometric.fom > 1.0);
+    CHECK_NEAR(zcGeometric.neutronMean, zcUniform.neutronMean, 0.1 * zcUniform.neutronMean);
+    CHECK_NEAR(zcGeometric.gammaMean, zcUniform.gammaMean, 0.1 * zcUniform.gammaMean);
+}
+
+namespace
+{
+
+/// @brief Largest-triangle-three-buckets on the pulse, x from a function of the sample index.
+template <typename X>
+std::vector<uint8_t> referenceLTTB(const NeutronDetector::Pulse& p, uint8_t points, X x)
+{
+    const uint8_t inner = NeutronDetector::SAMPLES_PER_PULSE - 2;
+    const uint8_t buckets = points - 2;
+    std::vector<uint8_t> selected = { 0 };
+    for (uint8_t b = 0; b < buckets; ++b)
+    {
+        const uint8_t start = 1 + b * inner / buckets;
+        const uint8_t end = 1 + (b + 1) * inner / buckets;
+        const uint8_t nextEnd = b + 1 < buckets ? 1 + (b + 2) * inner / buckets : NeutronDetector::SAMPLES_PER_PULSE;
+        double cx = 0;
+        double cy = 0;
+        for (uint8_t i = end; i < nextEnd; ++i)
+        {
+            cx += x(i);
+            cy += p.samples[i];
+        }
+        cx /= nextEnd - end;
+        cy /= nextEnd - end;
+
+        const double ax = x(selected.back());
+        const double ay = p.samples[selected.back()];
+        uint8_t best = start;
+        double bestArea = -1;
+        for (uint8_t i = start; i < end; ++i)
+        {
+            const double area = fabs((ax - cx) * (p.samples[i] - ay) - (ax - x(i)) * (cy - ay));
+            if (area > bestArea)
+            {
+                bestArea = area;
+                best = i;
+            }
+        }
+        selected.push_back(best);
+    }
+    selected.push_back(NeutronDetector::SAMPLES_PER_PULSE - 1);
+    return selected;
+}
+
+}
+
+HOST_TEST(lttbWeighsByTimeOnGeometricSchedule)
+{
+    host::reset(1000, 1);
+    NeutronDetector detector(A0);
+
+    uint16_t geometric[NeutronDetector::SAMPLES_PER_PULSE];
+    for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE; ++i)
+    {
+        geometric[i] = lround(NeutronDetectorProbe::geometricOffset(i, 6, NeutronDetector::SAMPLE_INTERVAL_US, 1.15f));
+    }
+    const PulseSet set = capture(geometric, 37);
+
+    // the triangles are spanned in time, with the index as x a stretched tail would pick other points
+    constexpr uint8_t POINTS = 10;
+    uint32_t matches = 0;
+    uint32_t indexWouldDiffer = 0;
+    uint32_t total = 0;
+    for (const std::vector<NeutronDetector::Pulse>* pulses : { &set.neutrons, &set.gammas })
+    {
+        for (const NeutronDetector::Pulse& p : *pulses)
+        {
+            uint8_t index[POINTS];
+            uint8_t value[POINTS];
+            const uint8_t n = NeutronDetectorProbe::lttb(detector, p, POINTS, index, value);
+            const std::vector<uint8_t> byTime = referenceLTTB(p, POINTS, [&p](uint8_t i) { return (double)p.sampleTimes[i]; });
+            const std::vector<uint8_t> byIndex = referenceLTTB(p, POINTS, [](uint8_t i) { return (double)i; });
+            if (n == POINTS && std::equal(byTime.begin(), byTime.end(), index)) matches++;
+            if (byIndex != byTime) indexWouldDiffer++;
+            total++;
+        }
+    }
+    REPORT("LTTB on a geometric schedule: %u of %u pulses match the time-weighted reference, the index as x differs on %u\n",
+           matches, total, indexWouldDiffer);
+
+    CHECK(matches == total);
+    CHECK(indexWouldDiffer > total / 10);
+}
+
+HOST_TEST(encodeWorstCasePulseFitsFrame)
+{
+    host::reset(1000, 1);
+    NeutronDetector detector(A0);
+
+    // every optional field present and every number at its widest
+    NeutronDetector::Pulse p = {};
+    p.timestamp = 10000000000000000000ULL;
+    p.serializedAt = UINT64_MAX;
+    for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE; ++i)
+    {
+        p.samples[i] = i % 2 ? 255 : 100;
+        p.sampleTimes[i] = UINT16_MAX - NeutronDetector::SAMPLES_PER_PULSE + i;
+    }
+    p.peakValue = 255;
+    p.flags = NeutronDetector::PULSE_FLAG_VETOED | NeutronDetector::PULSE_FLAG_PULSER;
+    p.tofCycles = NeutronDetector::TOF_INVALID - 1;
+    p.captureUs = UINT16_MAX;
+    p.analysisUs = UINT16_MAX;
+
+    // the longest fixed point text a float gives: negative, seven digits and the fraction
+    const float wide = -1048575.9375f;
+    const NeutronDetector::PulseAnalysis a = { wide, wide, wide, wide, wide, wide, true, wide, wide };
+
+    char frame[2048];
+    size_t longest = 0;
+    for (NeutronDetector::WaveformView view : { NeutronDetector::WaveformView::RAW, NeutronDetector::WaveformView::MINMAX,
+                                               NeutronDetector::WaveformView::LTTB })
+    {
+        const size_t length = NeutronDetectorProbe::encode(detector, frame, sizeof(frame), p, view, a);
+        REPORT("worst case pulse, view %d: %zu bytes\n", (int)view, length);
+        CHECK(length > 0);
+        longest = std::max(longest, length);
+    }
+    CHECK(longest <= NeutronDetector::STREAM_FRAME_MAX);
+}
@@ -0,0 +1,135 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <random>
+#include <type_traits>
+
+namespace
+{
+
+// WiFi TX corrupts single conversions, they read close to full scale
+constexpr double BASELINE = 24;
+constexpr double NOISE_RMS = 1.0;
+constexpr double SPIKE_PROBABILITY = 0.002;
+constexpr uint16_t SPIKE_VALUE = 1000;
+
+/// @brief Conversions of a quiet input with WiFi spikes.
+struct SpikyInput
+{
+    std::mt19937 random;
+    std::normal_distribution<double> noise{ 0, NOISE_RMS };
+    std::uniform_real_distribution<double> uniform{ 0, 1 };
+
+    explicit SpikyInput(uint32_t seed) : random(seed) {}
+
+    uint16_t operator()()
+    {
+        if (uniform(random) < SPIKE_PROBABILITY) return SPIKE_VALUE;
+        return (uint16_t)lround(BASELINE + noise(random));
+    }
+};
+
+}
+
+#if NEUTRON_OVERSAMPLE_COMBINER == NEUTRON_COMBINER_MEAN
+namespace
+{
+
+/// @brief Cost and spike rejection of one combiner over the same readings.
+struct CombinerResult
+{
+    double nsPerValue;
+    double falseTriggers;       // fraction of combined values above the lowest trigger threshold
+};
+
+template <typename Combiner>
+CombinerResult measure(const std::vector<uint16_t>& reads)
+{
+    const uint32_t values = reads.size() / Combiner::READS;
+
+    // the detector never sets the threshold closer than 4 * 2 counts to the baseline
+    uint32_t above = 0;
+    for (uint32_t v = 0; v < values; ++v)
+    {
+        Combiner c;
+        for (uint8_t i = 0; i < Combiner::READS; ++i) c.add(i, reads[v * Combiner::READS + i]);
+        if (c.result() >= BASELINE + 8) above++;
+    }
+
+    double best = 1e30;
+    volatile uint32_t sink = 0;
+    for (int round = 0; round < 5; ++round)
+    {
+        const uint64_t start = host::wallNs();
+        for (uint32_t v = 0; v < values; ++v)
+        {
+            Combiner c;
+            for (uint8_t i = 0; i < Combiner::READS; ++i) c.add(i, reads[v * Combiner::READS + i]);
+            sink = sink + c.result();
+        }
+        best = std::min(best, (host::wallNs() - start) / (double)values);
+    }
+    return { best, (double)above / values };
+}
+
+}
+
+HOST_TEST(combinersRejectSpikes)
+{
+    SpikyInput input(61);
+    std::vector<uint16_t> reads(16 * 200000);
+    for (uint16_t& r : reads) r = input();
+
+    const CombinerResult mean = measure<MeanCombiner<16>>(reads);
+    const CombinerResult median = measure<Median3Combiner<16>>(reads);
+    const CombinerResult trimmed = measure<TrimmedCombiner<16>>(reads);
+    const CombinerResult single = measure<SingleReadCombiner>(reads);
+    REPORT("spikes in %.1f%% of the conversions, fraction of values above the threshold floor and cost per value:\n", 100 * SPIKE_PROBABILITY);
+    REPORT("mean      %.5f  %5.1f ns\n", mean.falseTriggers, mean.nsPerValue);
+    REPORT("median3   %.5f  %5.1f ns\n", median.falseTriggers, median.nsPerValue);
+    REPORT("trimmed   %.5f  %5.1f ns\n", trimmed.falseTriggers, trimmed.nsPerValue);
+    REPORT("single    %.5f  %5.1f ns\n", single.falseTriggers, single.nsPerValue);
+
+    // one spike moves the mean of 16 by about 60 counts, the robust combiners need two close together
+    CHECK(mean.falseTriggers > 0.02);
+    CHECK(median.falseTriggers < mean.falseTriggers / 20);
+    CHECK(trimmed.falseTriggers < mean.falseTriggers / 20);
+}
+#endif
+
+HOST_TEST(overSampleFalseTriggerRate)
+{
+    host::reset(1000, 67);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    SpikyInput input(67);
+    host::setSignal([&input](double) { return input(); });
+
+    NeutronDetector detector(A0);
+    detector.begin();
+
+    const double seconds = 20;
+    const double end = host::now() + seconds * 1e6;
+    while (host::now() < end)
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+
+    // no pulses at all, every trigger is false
+    const double rate = host::jsonNumber(detector.getStatisticsJSON().str(), "total_pulses") / seconds;
+    REPORT("combiner %d: %.2f false triggers per second, spikes in %.1f%% of the conversions\n",
+           NEUTRON_OVERSAMPLE_COMBINER, rate, 100 * SPIKE_PROBABILITY);
+
+    // a poll every ~150 us, the mean fires on a few percent of them and the robust combiners on about 1e-4
+    if (std::is_same<DefaultPolicies::Filter, MeanCombiner<DefaultPolicies::OVERSAMPLE_COUNT>>::value)
+    {
+        CHECK(rate > 50);
+    }
+    else
+    {
+        CHECK(rate < 5);
+    }
+}
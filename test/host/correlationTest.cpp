@@ -0,0 +1,62 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+
+HOST_TEST(correlationGatesStartBehindDeadTime)
+{
+    host::reset(1000, 19);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 200;
+    config.neutronFraction = 1.0;
+    PulseSource source(config, 1000, 19);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+
+    // inside the dead time nothing can be counted, such a configuration is refused and changes nothing
+    CHECK(!detector.configureCorrelation(4, 4, 64, 4096));
+    CHECK(!detector.configureCorrelation(0, NeutronDetector::DEAD_TIME_US - 1, 0, 0));
+    CHECK(!detector.configureCorrelation(NeutronDetector::DEAD_TIME_US / NeutronCorrelation::ROSSI_BINS, NeutronDetector::DEAD_TIME_US, 0, 0));
+
+    const double end = host::now() + 20e6;
+    while (host::now() < end)
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+
+    std::string json = server.request("/neutron/correlation").body.str();
+    const double deadTime = host::jsonNumber(json, "dead_time_us");
+    const double binUs = host::jsonNumber(json, "rossi_bin_us");
+    const std::vector<double> rossi = host::jsonArray(json, "rossi_alpha");
+    REPORT("dead time %.0f us, Rossi bin %.0f us, predelay %.0f us, gate %.0f us, long delay %.0f us, %.0f singles\n",
+           deadTime, binUs, host::jsonNumber(json, "predelay_us"), host::jsonNumber(json, "gate_us"),
+           host::jsonNumber(json, "long_delay_us"), host::jsonNumber(json, "singles"));
+
+    CHECK(deadTime == NeutronDetector::DEAD_TIME_US);
+    CHECK(host::jsonNumber(json, "predelay_us") >= deadTime);
+    CHECK(host::jsonNumber(json, "gate_us") >= deadTime);
+    CHECK(host::jsonNumber(json, "ring_overflows") == 0);
+    CHECK(host::jsonNumber(json, "singles") > 100);
+
+    // the histogram shows the dead time as empty leading bins and counts behind it
+    CHECK(rossi.size() == NeutronCorrelation::ROSSI_BINS);
+    double dead = 0;
+    double live = 0;
+    for (size_t i = 0; i < rossi.size(); ++i) ((i + 1) * binUs <= deadTime ? dead : live) += rossi[i];
+    CHECK(dead == 0);
+    CHECK(live > 0);
+
+    CHECK(detector.configureCorrelation(0, NeutronDetector::DEAD_TIME_US, NeutronDetector::DEAD_TIME_US, 0));
+    json = server.request("/neutron/correlation").body.str();
+    CHECK(host::jsonNumber(json, "gate_us") == NeutronDetector::DEAD_TIME_US);
+    CHECK(host::jsonNumber(json, "singles") == 0);
+}
@@ -0,0 +1,194 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+
+namespace
+{
+
+constexpr double SETTLE_US = 5e6;      // counting before the fault, also the rate reference after it
+constexpr double FAULT_US = 2e6;
+
+/// @brief A detector counting a steady neutron source, with a fault injected through the HTTP API.
+struct FaultScenario
+{
+    PulseSource source;
+    NeutronDetector detector;
+    ESP8266WebServer server;
+    uint32_t countedDuringFault = 0;
+
+    static PulseSource::Config config()
+    {
+        PulseSource::Config c;
+        c.rateHz = 200;
+        c.neutronFraction = 1.0;
+        return c;
+    }
+
+    FaultScenario() : source(config(), 1000, 17), detector(A0)
+    {
+        host::reset(1000, 17);
+        host::setCosts(0.5);
+        LittleFS.format();
+        host::setSignal([this](double t) { return source(t); });
+        detector.begin();
+        detector.registerHTTPEndpoints(server);
+    }
+
+    std::string stats()
+    {
+        return detector.getStatisticsJSON().str();
+    }
+
+    double counted()
+    {
+        return host::jsonNumber(stats(), "total_pulses");
+    }
+
+    /// @brief Run the sketch loop, counting what is counted while the fault is active.
+    void run(double us)
+    {
+        const double end = host::now() + us;
+        double nextPoll = host::now();
+        double last = counted();
+        while (host::now() < end)
+        {
+            detector.update();
+            delayMicroseconds(100);
+            if (host::now() < nextPoll) continue;
+
+            nextPoll += 10000;
+            std::string s = stats();
+            double total = host::jsonNumber(s, "total_pulses");
+            if (host::jsonNumber(s, "fault_mode") != 0) countedDuringFault += total - last;
+            last = total;
+        }
+    }
+
+    /**
+     * @brief Count, inject a fault, wait for the recovery and count again.
+     * @param query The fault endpoint query.
+     * @param name Printed in the report.
+     */
+    void check(const char* query, const char* name)
+    {
+        // the input check runs once a second, the fault must not line up with it
+        run(SETTLE_US + 370000);
+        const double settled = counted();
+        const double settledAt = host::now();
+        run(SETTLE_US);
+        const double before = counted() - settled;
+        const double injectedAt = host::now();
+        CHECK(server.request(String("/neutron/fault?") + query).code == 200);
+
+        run(FAULT_US + 3e6);
+        std::string s = stats();
+        const double blindUs = host::jsonNumber(s, "fault_blind_us");
+        const double recoveryUs = host::jsonNumber(s, "fault_recovery_us");
+        const double lost = host::jsonNumber(s, "fault_lost_events");
+
+        // ground truth: the events the source produced while blind, at the efficiency seen before
+        const double efficiency = before / source.countBetween(settledAt, injectedAt);
+        const double missed = efficiency * source.countBetween(injectedAt, injectedAt + blindUs);
+
+        const double after = counted();
+        run(SETTLE_US);
+        const double rateRatio = (counted() - after) / before;
+
+        REPORT("%-9s blind %.0f ms, recovery %.1f ms, %.0f lost (%.0f expected), rate after %.2f of before\n",
+               name, blindUs / 1000, recoveryUs / 1000, lost, missed, rateRatio);
+
+        CHECK(countedDuringFault == 0);
+        CHECK(blindUs >= FAULT_US);
+        CHECK(blindUs < FAULT_US + 3e6);
+        CHECK_NEAR(lost, missed, 0.25 * missed);
+        CHECK_NEAR(rateRatio, 1.0, 0.15);
+    }
+};
+
+}
+
+HOST_TEST(faultSaturateDisconnectsAndRecovers)
+{
+    FaultScenario f;
+    f.check("mode=saturate&duration_ms=2000", "saturate");
+
+    // the disconnect is only seen by the once a second input check, and so is the reconnect
+    CHECK(host::jsonNumber(f.stats(), "disconnect_resets") >= 1);
+    CHECK(host::jsonNumber(f.stats(), "fault_recovery_us") < 1.1e6);
+}
+
+HOST_TEST(faultFloatingInputCountsNothing)
+{
+    FaultScenario f;
+    f.check("mode=floating&duration_ms=2000", "floating");
+    CHECK(host::jsonNumber(f.stats(), "fault_recovery_us") < 100000);
+}
+
+HOST_TEST(faultStuckLowDisconnects)
+{
+    FaultScenario f;
+    f.check("mode=stuck&value=0&duration_ms=2000", "stuck 0");
+    CHECK(host::jsonNumber(f.stats(), "disconnect_resets") >= 1);
+}
+
+HOST_TEST(faultStuckAtBaselineStaysConnected)
+{
+    FaultScenario f;
+    f.check("mode=stuck&value=24&duration_ms=2000", "stuck 24");
+    CHECK(host::jsonNumber(f.stats(), "disconnect_resets") == 0);
+}
+
+HOST_TEST(faultEndedEarly)
+{
+    FaultScenario f;
+    f.run(SETTLE_US);
+    f.server.request("/neutron/fault?mode=floating&duration_ms=60000");
+    f.run(1e6);
+    f.server.request("/neutron/fault?mode=none");
+    f.run(1e6);
+
+    std::string s = f.stats();
+    CHECK(host::jsonNumber(s, "fault_mode") == 0);
+    CHECK(host::jsonNumber(s, "fault_blind_us") < 1.2e6);
+}
+
+HOST_TEST(faultDroppedClientsDoNotBlindAcquisition)
+{
+    FaultScenario f;
+    f.run(SETTLE_US);
+    const double before = f.counted();
+    f.server.request("/neutron/fault?mode=drop&duration_ms=2000");
+
+    CHECK(!f.server.request("/neutron/stats").complete);
+    f.run(FAULT_US + 1e6);
+    CHECK(f.server.request("/neutron/stats").complete);
+
+    std::string s = f.stats();
+    CHECK(host::jsonNumber(s, "client_drops") >= 1);
+    CHECK(host::jsonNumber(s, "fault_blind_us") == 0);
+    CHECK(host::jsonNumber(s, "fault_lost_events") == 0);
+    CHECK(f.counted() - before > 0.4 * before);
+}
+
+HOST_TEST(faultBlindPulserTicksAreNotRecorded)
+{
+    FaultScenario f;
+    f.detector.enablePulser(10000);
+    f.run(SETTLE_US);
+    std::string s = f.stats();
+    const double requested = host::jsonNumber(s, "pulser_requested");
+    const double recorded = host::jsonNumber(s, "pulser_recorded");
+
+    // stuck at the baseline the input stays connected, only the blind gate stops the ticks
+    f.server.request("/neutron/fault?mode=stuck&value=24&duration_ms=2000");
+    f.run(FAULT_US - 100000);
+
+    s = f.stats();
+    const double blindRequested = host::jsonNumber(s, "pulser_requested") - requested;
+    const double blindRecorded = host::jsonNumber(s, "pulser_recorded") - recorded;
+    REPORT("blind: %.0f of %.0f pulser ticks recorded\n", blindRecorded, blindRequested);
+    CHECK(blindRequested > 150);
+    CHECK(blindRecorded == 0);
+}
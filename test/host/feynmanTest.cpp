@@ -0,0 +1,135 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <random>
+
+namespace
+{
+
+constexpr uint32_t DEAD_TIME_US = NeutronDetector::DEAD_TIME_US;
+
+/// @brief Y and its spread for gates of one width, from the closed gates.
+struct GateY
+{
+    double widthUs;
+    double y;
+    double sigma;       // statistical error of Y for uncorrelated gates
+    double gates;
+};
+
+std::vector<GateY> readY(const std::string& json, const char* key)
+{
+    const std::vector<double> widths = host::jsonArray(json, "gate_us");
+    const std::vector<double> y = host::jsonArray(json, key);
+    const std::vector<double> gates = host::jsonArray(json, "gates");
+    const std::vector<double> mean = host::jsonArray(json, "mean");
+    std::vector<GateY> result;
+    for (size_t k = 0; k < widths.size(); ++k)
+    {
+        // the variance of a sample variance over its mean, Poisson counts
+        const double sigma = gates[k] > 1 ? sqrt((2.0 + 1.0 / std::max(mean[k], 1e-9)) / (gates[k] - 1)) : INFINITY;
+        result.push_back({ widths[k], y[k], sigma, gates[k] });
+    }
+    return result;
+}
+
+}
+
+HOST_TEST(feynmanPoissonWithDeadTimeCorrectsToZero)
+{
+    // a Poisson trigger stream with a non-paralyzable dead time, half of the triggers classified neutrons
+    FeynmanAnalysis f;
+    f.setDeadTime(DEAD_TIME_US);
+    std::mt19937 random(23);
+    std::exponential_distribution<double> wait(300e-6);
+    double t = 0;
+    uint32_t triggers = 0;
+    uint32_t neutrons = 0;
+    while (t < 2000e6)
+    {
+        t += DEAD_TIME_US + wait(random);
+        triggers++;
+        if (std::uniform_real_distribution<double>(0, 1)(random) < 0.5)
+        {
+            f.addEvent((uint64_t)t);
+            neutrons++;
+        }
+    }
+
+    StaticJsonDocument<3072> doc;
+    const double rate = triggers / (t / 1e6);
+    f.toJSON(doc, rate, (float)neutrons / triggers);
+    String output;
+    serializeJson(doc, output);
+    const std::string json = output.c_str();
+
+    const std::vector<GateY> raw = readY(json, "y");
+    const std::vector<GateY> corrected = readY(json, "y_corrected");
+    const std::vector<double> bias = host::jsonArray(json, "dead_time_bias");
+    REPORT("%u triggers at %.0f Hz, dead time busy %.2f\n", triggers, rate, rate * DEAD_TIME_US / 1e6);
+    for (size_t k = 0; k < raw.size(); ++k)
+    {
+        REPORT("gate %7.0f us: Y %+.3f, bias %+.3f, corrected %+.4f +/- %.4f over %.0f gates\n",
+               raw[k].widthUs, raw[k].y, bias[k], corrected[k].y, corrected[k].sigma, corrected[k].gates);
+    }
+
+    CHECK(host::jsonNumber(json, "dead_time_us") == DEAD_TIME_US);
+    CHECK(raw.front().widthUs >= DEAD_TIME_US);
+    CHECK(!f.configure(DEAD_TIME_US - 1));
+
+    // the dead time alone pushes Y well below zero, the correction brings every usable width back to it
+    for (size_t k = 0; k < corrected.size(); ++k)
+    {
+        if (corrected[k].gates < 1000) continue;
+        CHECK(raw[k].y < -4 * raw[k].sigma);
+        CHECK_NEAR(corrected[k].y, 0.0, 4 * corrected[k].sigma);
+    }
+}
+
+HOST_TEST(feynmanDetectorReportsDeadTime)
+{
+    host::reset(1000, 29);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 200;
+    config.neutronFraction = 1.0;
+    PulseSource source(config, 1000, 29);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+    CHECK(!detector.configureFeynman(DEAD_TIME_US / 2));
+
+    const double end = host::now() + 60e6;
+    while (host::now() < end)
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+
+    std::string json = server.request("/neutron/feynman").body.str();
+    const std::vector<GateY> corrected = readY(json, "y_corrected");
+    const std::vector<double> bias = host::jsonArray(json, "dead_time_bias");
+    REPORT("dead time %.0f us, %.0f Hz triggers, %.2f neutrons, narrowest gate %.0f us: bias %+.4f, Y corrected %+.3f +/- %.3f\n",
+           host::jsonNumber(json, "dead_time_us"), host::jsonNumber(json, "trigger_rate_hz"), host::jsonNumber(json, "neutron_fraction"),
+           corrected.front().widthUs, bias.front(), corrected.front().y, corrected.front().sigma);
+
+    CHECK(host::jsonNumber(json, "dead_time_us") == DEAD_TIME_US);
+    CHECK(bias.size() == FeynmanAnalysis::GATE_WIDTHS);
+    CHECK(host::jsonNumber(json, "trigger_rate_hz") > 100);
+    CHECK(corrected.size() == FeynmanAnalysis::GATE_WIDTHS);
+    CHECK(corrected.front().widthUs >= DEAD_TIME_US);
+    CHECK(corrected.front().gates > 1000);
+
+    // a Poisson source seen through the trigger, nothing but the dead time correlates the neutrons
+    for (const GateY& g : corrected)
+    {
+        if (g.gates >= 1000) CHECK_NEAR(g.y, 0.0, 4 * g.sigma);
+    }
+}
@@ -0,0 +1,46 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "neutronDetector.h"
+#include "goldenCorpus.h"
+#include <LittleFS.h>
+
+namespace
+{
+
+// an 80 MHz LX106 without an FPU against one core of a current x86 host, on the soft-float heavy analysis
+constexpr double ESP_NS_PER_HOST_NS = 250;
+
+}
+
+HOST_TEST(goldenCorpusGates)
+{
+    host::reset(1000, 41);
+    LittleFS.format();
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+
+    // the self test times analyzePulse() with the cycle counter, here it counts modelled ESP cycles
+    host::setCpuModel(ESP_NS_PER_HOST_NS);
+    const std::string json = server.request("/neutron/selftest").body.str();
+    host::setCpuModel(0);
+
+    const size_t mismatches = json.find("\"mismatches\":[]") == std::string::npos ? json.find("\"mismatches\":[") : std::string::npos;
+    REPORT("corpus version %.0f, %.0f of %.0f correct, %.0f feature mismatches, modelled cycles mean %.0f max %.0f of %.0f\n",
+           host::jsonNumber(json, "corpus_version"), host::jsonNumber(json, "correct"), host::jsonNumber(json, "waveforms"),
+           host::jsonNumber(json, "feature_mismatches"), host::jsonNumber(json, "mean_cycles"),
+           host::jsonNumber(json, "max_cycles"), host::jsonNumber(json, "cycle_budget"));
+    if (mismatches != std::string::npos) REPORT("%s\n", json.substr(mismatches, json.find(']', mismatches) - mismatches + 1).c_str());
+
+    // each gate on its own, so the log names the one that failed
+    CHECK(host::jsonNumber(json, "corpus_version") == GOLDEN_CORPUS_VERSION);
+    CHECK(host::jsonNumber(json, "waveforms") == GOLDEN_CORPUS_SIZE);
+    CHECK(host::jsonNumber(json, "accuracy") >= NeutronDetector::SELFTEST_MIN_ACCURACY);
+    CHECK(host::jsonNumber(json, "feature_mismatches") == 0);
+    CHECK(host::jsonNumber(json, "probability_checked") == 1);
+    CHECK(host::jsonNumber(json, "max_cycles") > 0);
+    CHECK(host::jsonNumber(json, "max_cycles") <= host::jsonNumber(json, "cycle_budget"));
+    CHECK(host::jsonNumber(json, "passed") == 1);
+}
@@ -0,0 +1,436 @@
+#include "hostHarness.h"
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <ctime>
+#include <queue>
+#include <random>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+FS LittleFS;
+
+namespace
+{
+
+struct Edge
+{
+    double timeUs;
+    uint8_t pin;
+    bool operator>(const Edge& other) const { return timeUs > other.timeUs; }
+};
+
+struct Handler
+{
+    void (*function)(void*);
+    void* arg;
+};
+
+double _nowUs = 0;
+double _adcReadUs = 10.0;
+double _clockReadUs = 0.05;
+double _espNsPerHostNs = 0;
+uint64_t _lastCpuNs = 0;
+uint64_t _adcReads = 0;
+bool _verbose = false;
+int _interruptsDisabled = 0;
+bool _inHandler = false;
+host::Signal _signal;
+std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge>> _edges;
+std::map<uint8_t, Handler> _handlers;
+std::mt19937 _random;
+
+void fireDueEdges()
+{
+    if (_interruptsDisabled > 0 || _inHandler) return;
+
+    while (!_edges.empty() && _edges.top().timeUs <= _nowUs)
+    {
+        Edge edge = _edges.top();
+        _edges.pop();
+
+        auto handler = _handlers.find(edge.pin);
+        if (handler == _handlers.end()) continue;
+
+        _inHandler = true;
+        handler->second.function(handler->second.arg);
+        _inHandler = false;
+    }
+}
+
+uint64_t threadCpuNs()
+{
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/// Every clock read first charges the host CPU time spent since the previous one, if a CPU model is set
+void chargeCpu()
+{
+    if (_espNsPerHostNs <= 0) return;
+    const uint64_t cpu = threadCpuNs();
+    _nowUs += (cpu - _lastCpuNs) * _espNsPerHostNs / 1000.0;
+    _lastCpuNs = cpu;
+}
+
+}
+
+namespace host
+{
+
+void reset(uint64_t startUs, uint32_t seed)
+{
+    _nowUs = startUs;
+    _adcReadUs = 10.0;
+    _clockReadUs = 0.05;
+    _espNsPerHostNs = 0;
+    _adcReads = 0;
+    _interruptsDisabled = 0;
+    _signal = nullptr;
+    _edges = {};
+    _handlers.clear();
+    _random.seed(seed);
+}
+
+double now()
+{
+    return _nowUs;
+}
+
+void advance(double us)
+{
+    _nowUs += us;
+    fireDueEdges();
+}
+
+void setCosts(double adcReadUs, double clockReadUs)
+{
+    _adcReadUs = adcReadUs;
+    _clockReadUs = clockReadUs;
+}
+
+void setCpuModel(double espNsPerHostNs)
+{
+    _espNsPerHostNs = espNsPerHostNs;
+    _lastCpuNs = threadCpuNs();
+}
+
+void setSignal(Signal signal)
+{
+    _signal = signal;
+}
+
+void scheduleEdge(uint8_t pin, double timeUs)
+{
+    _edges.push({ timeUs, pin });
+}
+
+uint64_t adcReads()
+{
+    return _adcReads;
+}
+
+void setVerbose(bool verbose)
+{
+    _verbose = verbose;
+}
+
+uint64_t wallNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (_verbose) putchar(c);
+    return 1;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    chargeCpu();
+    host::advance(_clockReadUs);
+    return (uint32_t)(uint64_t)(_nowUs * getCpuFreqMHz());
+}
+
+uint32_t micros()
+{
+    chargeCpu();
+    host::advance(_clockReadUs);
+    return (uint32_t)(uint64_t)_nowUs;
+}
+
+uint64_t micros64()
+{
+    chargeCpu();
+    host::advance(_clockReadUs);
+    return (uint64_t)_nowUs;
+}
+
+uint32_t millis()
+{
+    return (uint32_t)(micros64() / 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    host::advance(us);
+}
+
+void delay(unsigned long ms)
+{
+    host::advance(ms * 1000.0);
+}
+
+void yield()
+{
+}
+
+int analogRead(uint8_t)
+{
+    // the conversion samples the input at its end
+    host::advance(_adcReadUs);
+    _adcReads++;
+    int value = _signal ? _signal(_nowUs) : 512;
+    return constrain(value, 0, 1023);
+}
+
+void pinMode(uint8_t, uint8_t)
+{
+}
+
+int digitalRead(uint8_t)
+{
+    return 0;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int)
+{
+    _handlers[pin] = { handler, arg };
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    _handlers.erase(pin);
+}
+
+void noInterrupts()
+{
+    _interruptsDisabled++;
+}
+
+void interrupts()
+{
+    if (_interruptsDisabled > 0) _interruptsDisabled--;
+    fireDueEdges();
+}
+
+long random(long howBig)
+{
+    if (howBig <= 0) return 0;
+    return std::uniform_int_distribution<long>(0, howBig - 1)(_random);
+}
+
+long random(long howSmall, long howBig)
+{
+    if (howSmall >= howBig) return howSmall;
+    return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+    _random.seed(seed);
+}
+
+// ----- network -----
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size)
+{
+    (void)buffer;
+    if (!_connected) return 0;
+
+    if (_dropAfter > 0 && _sent + size >= _dropAfter)
+    {
+        size = _dropAfter - _sent;
+        _connected = false;
+    }
+    _sent += size;
+    return size;
+}
+
+void WiFiClient::open(size_t dropAfterBytes)
+{
+    _connected = true;
+    _sent = 0;
+    _dropAfter = dropAfterBytes;
+}
+
+void ESP8266WebServer::on(const String& uri, HTTPMethod, THandlerFunction handler)
+{
+    _handlers[uri.str()] = handler;
+}
+
+String ESP8266WebServer::arg(const String& name) const
+{
+    auto it = _args.find(name.str());
+    return it == _args.end() ? String() : String(it->second);
+}
+
+bool ESP8266WebServer::hasArg(const String& name) const
+{
+    return _args.count(name.str()) > 0;
+}
+
+void ESP8266WebServer::send(int code, const char*, const String& body)
+{
+    _response.code = code;
+    if (_contentLength == CONTENT_LENGTH_UNKNOWN)
+    {
+        _response.chunked = true;
+        if (body.length() > 0) sendContent(body);
+        return;
+    }
+    deliver(body.c_str(), body.length());
+    _response.complete = _client.connected();
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t length)
+{
+    if (length == 0)
+    {
+        _response.complete = _client.connected();
+        return;
+    }
+    _response.chunks++;
+    _response.maxChunk = max(_response.maxChunk, length);
+    deliver(content, length);
+}
+
+void ESP8266WebServer::deliver(const char* data, size_t length)
+{
+    size_t sent = _client.write((const uint8_t*)data, length);
+    _response.body.concat(data, sent);
+}
+
+ESP8266WebServer::Response ESP8266WebServer::request(const String& uri, size_t dropAfterBytes)
+{
+    std::string path = uri.str();
+    _args.clear();
+
+    size_t query = path.find('?');
+    if (query != std::string::npos)
+    {
+        std::string args = path.substr(query + 1);
+        path = path.substr(0, query);
+
+        size_t start = 0;
+        while (start < args.size())
+        {
+            size_t end = args.find('&', start);
+            if (end == std::string::npos) end = args.size();
+            std::string pair = args.substr(start, end - start);
+            size_t equals = pair.find('=');
+            if (equals == std::string::npos) _args[pair] = "";
+            else _args[pair.substr(0, equals)] = pair.substr(equals + 1);
+            start = end + 1;
+        }
+    }
+
+    _response = Response();
+    _contentLength = 0;
+    _client.open(dropAfterBytes);
+
+    auto handler = _handlers.find(path);
+    if (handler == _handlers.end())
+    {
+        _response.code = 404;
+        return _response;
+    }
+    handler->second();
+    return _response;
+}
+
+// ----- file system -----
+
+size_t File::write(const uint8_t* buffer, size_t size)
+{
+    if (!_data || !_writable || !LittleFS.mutate()) return 0;
+
+    if (_position + size > _data->size()) _data->resize(_position + size);
+    memcpy(_data->data() + _position, buffer, size);
+    _position += size;
+    return size;
+}
+
+size_t File::read(uint8_t* buffer, size_t size)
+{
+    if (!_data) return 0;
+
+    size_t n = min(size, _data->size() - _position);
+    memcpy(buffer, _data->data() + _position, n);
+    _position += n;
+    return n;
+}
+
+File FS::open(const char* path, const char* mode)
+{
+    auto it = _files.find(path);
+    if (mode[0] == 'r')
+    {
+        if (it == _files.end()) return File();
+        return File(it->second, false, 0);
+    }
+
+    if (!mutate()) return File();
+    if (it == _files.end() || mode[0] == 'w')
+    {
+        _files[path] = std::make_shared<std::vector<uint8_t>>();
+        it = _files.find(path);
+    }
+    return File(it->second, true, mode[0] == 'a' ? it->second->size() : 0);
+}
+
+bool FS::remove(const char* path)
+{
+    if (!exists(path) || !mutate()) return false;
+    _files.erase(path);
+    return true;
+}
+
+bool FS::rename(const char* from, const char* to)
+{
+    auto it = _files.find(from);
+    if (it == _files.end() || !mutate()) return false;
+
+    // like LittleFS, an existing target is replaced in the same atomic step
+    _files[to] = it->second;
+    _files.erase(from);
+    return true;
+}
+
+bool FS::mutate()
+{
+    if (_budget == 0) return false;
+    if (_budget > 0) _budget--;
+    _operations++;
+    return true;
+}
+
+std::map<std::string, std::vector<uint8_t>> FS::image() const
+{
+    std::map<std::string, std::vector<uint8_t>> files;
+    for (const auto& f : _files) files[f.first] = *f.second;
+    return files;
+}
+
+void FS::load(const std::map<std::string, std::vector<uint8_t>>& image)
+{
+    _files.clear();
+    for (const auto& f : image) _files[f.first] = std::make_shared<std::vector<uint8_t>>(f.second);
+    _budget = -1;
+}
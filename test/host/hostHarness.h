@@ -0,0 +1,64 @@
+// Virtual clock, analog signal and interrupt edges behind the host Arduino stand-in.
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+#include <Arduino.h>
+#include <vector>
+
+namespace host
+{
+
+/// Signal seen by analogRead(), called with the virtual time in microseconds, returns 10-bit ADC counts.
+typedef std::function<int(double timeUs)> Signal;
+
+/**
+ * @brief Reset the virtual clock, cost model, pending edges, interrupt handlers and the random generator.
+ * @param startUs The initial value of micros64(), choose one close to a wrap to exercise it.
+ * @param seed Seed of random().
+ */
+void reset(uint64_t startUs = 0, uint32_t seed = 1);
+
+/// @brief The virtual time in microseconds, with fractions.
+double now();
+
+/**
+ * @brief Advance the virtual clock, firing due interrupt edges.
+ * @param us The time to add in microseconds.
+ */
+void advance(double us);
+
+/**
+ * @brief Set the cost model of the core calls.
+ * @param adcReadUs Time one analogRead() takes.
+ * @param clockReadUs Time one micros() or cycle counter read takes, keeps busy waits moving.
+ */
+void setCosts(double adcReadUs, double clockReadUs = 0.05);
+
+/**
+ * @brief Charge host CPU time to the virtual clock, so the cost of the code itself shows in micros() and the cycle counter.
+ * @param espNsPerHostNs How much slower the ESP8266 runs the code than the host, 0 leaves computation free.
+ */
+void setCpuModel(double espNsPerHostNs);
+
+/// @brief Set the signal on the analog input, a constant mid-scale level by default.
+void setSignal(Signal signal);
+
+/**
+ * @brief Queue a rising edge on a digital pin, the attached handler runs when the clock passes it.
+ * @param pin The pin.
+ * @param timeUs The virtual time of the edge.
+ */
+void scheduleEdge(uint8_t pin, double timeUs);
+
+/// @brief The number of analogRead() calls since reset().
+uint64_t adcReads();
+
+/// @brief Echo Serial output to stdout.
+void setVerbose(bool verbose);
+
+/// @brief Wall clock in nanoseconds, for the throughput and cost reports.
+uint64_t wallNs();
+
+}
+
+#endif // HOST_HARNESS_H
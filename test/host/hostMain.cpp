@@ -0,0 +1,25 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include <cstring>
+
+int main(int argc, char** argv)
+{
+    // an optional argument runs only the tests whose name contains it
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    host::setVerbose(getenv("HOST_VERBOSE") != nullptr);
+
+    int run = 0;
+    for (const host::TestCase& test : host::tests())
+    {
+        if (filter && !strstr(test.name, filter)) continue;
+
+        int before = host::failures();
+        printf("[ RUN  ] %s\n", test.name);
+        test.function();
+        printf("[ %s ] %s\n", host::failures() == before ? " OK " : "FAIL", test.name);
+        run++;
+    }
+
+    printf("%d tests, %d failed checks\n", run, host::failures());
+    return host::failures() == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Minimal test registry and checks for the host tests, one binary runs every test linked into it.
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace host
+{
+
+struct TestCase
+{
+    const char* name;
+    void (*function)();
+};
+
+inline std::vector<TestCase>& tests()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+struct Registrar
+{
+    Registrar(const char* name, void (*function)()) { tests().push_back({ name, function }); }
+};
+
+/**
+ * @brief Read a numeric field from a JSON body without a parser, the first occurrence of the key wins.
+ * @param json The JSON text.
+ * @param key The field name.
+ * @param fallback Returned if the field is missing or not a number.
+ * @return double The value, true and false read as 1 and 0.
+ */
+inline double jsonNumber(const std::string& json, const char* key, double fallback = NAN)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t at = json.find(pattern);
+    if (at == std::string::npos) return fallback;
+
+    const char* value = json.c_str() + at + pattern.size();
+    if (strncmp(value, "true", 4) == 0) return 1;
+    if (strncmp(value, "false", 5) == 0) return 0;
+
+    char* end;
+    double number = strtod(value, &end);
+    return end == value ? fallback : number;
+}
+
+/**
+ * @brief Read a numeric array field from a JSON body.
+ * @param json The JSON text.
+ * @param key The field name.
+ * @return std::vector<double> The values, empty if the field is missing.
+ */
+inline std::vector<double> jsonArray(const std::string& json, const char* key)
+{
+    std::vector<double> values;
+    std::string pattern = std::string("\"") + key + "\":[";
+    size_t at = json.find(pattern);
+    if (at == std::string::npos) return values;
+
+    const char* p = json.c_str() + at + pattern.size();
+    while (*p && *p != ']')
+    {
+        char* end;
+        double number = strtod(p, &end);
+        if (end == p) break;
+        values.push_back(number);
+        p = end;
+        if (*p == ',') p++;
+    }
+    return values;
+}
+
+/**
+ * @brief Read every occurrence of an integer field, e.g. the timestamps of all pulses in a response.
+ * @param json The JSON text.
+ * @param key The field name.
+ * @return std::vector<uint64_t> The values in document order, exact up to 64 bits.
+ */
+inline std::vector<uint64_t> jsonIntegers(const std::string& json, const char* key)
+{
+    std::vector<uint64_t> values;
+    std::string pattern = std::string("\"") + key + "\":";
+    for (size_t at = json.find(pattern); at != std::string::npos; at = json.find(pattern, at + 1))
+    {
+        values.push_back(strtoull(json.c_str() + at + pattern.size(), nullptr, 10));
+    }
+    return values;
+}
+
+}
+
+#define HOST_TEST(name) \
+    static void name(); \
+    static host::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            host::failures()++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double a_ = (actual), e_ = (expected); \
+        if (!(fabs(a_ - e_) <= (tolerance))) { \
+            printf("  FAIL %s:%d: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__, #actual, a_, e_, (double)(tolerance)); \
+            host::failures()++; \
+        } \
+    } while (0)
+
+/// Report lines are prefixed so they are easy to grep out of the CI log
+#define REPORT(...) printf("  | " __VA_ARGS__)
+
+#endif // HOST_TEST_H
@@ -0,0 +1,143 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "histogramJournal.h"
+
+namespace
+{
+
+constexpr uint16_t BINS = 100;     // more than one 32 record batch per region
+
+struct Histograms
+{
+    uint32_t a[BINS] = {};
+    uint32_t b[BINS] = {};
+    HistogramJournal journal;
+
+    Histograms(uint32_t tagB = 0)
+    {
+        journal.addRegion(a, BINS);
+        journal.addRegion(b, BINS, tagB);
+        journal.begin();
+    }
+
+    void fill(uint32_t base)
+    {
+        for (uint16_t i = 0; i < BINS; i++)
+        {
+            a[i] = base + i;
+            b[i] = base + 1000 + i;
+            journal.markDirty(0, i);
+            journal.markDirty(1, i);
+        }
+    }
+};
+
+}
+
+HOST_TEST(journalRestoresCheckpoints)
+{
+    host::reset();
+    LittleFS.format();
+
+    {
+        Histograms h;
+        h.journal.restore();
+        h.fill(1);
+        CHECK(h.journal.checkpoint());
+        h.a[5] = 77;
+        h.journal.markDirty(0, 5);
+        CHECK(h.journal.checkpoint());
+    }
+
+    Histograms restored;
+    CHECK(restored.journal.restore());
+    CHECK(restored.a[5] == 77);
+    CHECK(restored.a[6] == 7);
+    CHECK(restored.b[99] == 1100);
+}
+
+HOST_TEST(journalSurvivesPowerCutDuringCompact)
+{
+    host::reset();
+    LittleFS.format();
+
+    // v1 is durable in base plus journal, the compaction writes v2
+    {
+        Histograms h;
+        h.journal.restore();
+        h.fill(100);
+        h.journal.compact();
+        h.fill(200);
+        h.journal.checkpoint();
+    }
+    auto before = LittleFS.image();
+
+    long operations = 0;
+    {
+        Histograms h;
+        h.journal.restore();
+        h.fill(300);
+        long start = LittleFS.operations();
+        CHECK(h.journal.compact());
+        operations = LittleFS.operations() - start;
+    }
+
+    for (long cut = 0; cut <= operations; cut++)
+    {
+        LittleFS.load(before);
+        {
+            Histograms h;
+            h.journal.restore();
+            h.fill(300);
+            LittleFS.cutPowerAfter(cut);
+            h.journal.compact();
+        }
+        LittleFS.cutPowerAfter(-1);
+
+        Histograms r;
+        r.journal.restore();
+        bool consistent = true;
+        bool allNew = true;
+        for (uint16_t i = 0; i < BINS; i++)
+        {
+            consistent = consistent && (r.a[i] == 200u + i || r.a[i] == 300u + i);
+            consistent = consistent && (r.b[i] == 1200u + i || r.b[i] == 1300u + i);
+            allNew = allNew && r.a[i] == 300u + i && r.b[i] == 1300u + i;
+        }
+        if (!consistent) printf("  power cut after %ld of %ld operations\n", cut, operations);
+        CHECK(consistent);
+        if (cut == operations) CHECK(allNew);
+    }
+}
+
+HOST_TEST(journalDiscardsChangedLayout)
+{
+    host::reset();
+    LittleFS.format();
+
+    {
+        Histograms h(10);
+        h.journal.restore();
+        h.fill(1);
+        h.journal.checkpoint();
+    }
+
+    {
+        // region b now has another bin width, only region a may come back
+        Histograms h(20);
+        h.journal.restore();
+        CHECK(h.a[3] == 4);
+        CHECK(h.b[3] == 0);
+    }
+
+    Histograms again(20);
+    again.journal.restore();
+    CHECK(again.a[3] == 4);
+    CHECK(again.b[3] == 0);
+
+    CHECK(again.journal.retag(1, 30));
+    CHECK(!again.journal.retag(1, 30));
+    Histograms retagged(30);
+    retagged.journal.restore();
+    CHECK(retagged.a[3] == 4);
+}
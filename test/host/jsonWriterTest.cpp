@@ -0,0 +1,178 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "jsonWriter.h"
+#include <ArduinoJson.h>
+#include <random>
+
+namespace
+{
+
+std::string writeFixed(float value, uint8_t decimals)
+{
+    char buffer[48];
+    JsonWriter w(buffer, sizeof(buffer));
+    w.fixed(value, decimals);
+    return std::string(buffer, w.finish());
+}
+
+std::string writeFixed(double value, uint8_t decimals)
+{
+    char buffer[48];
+    JsonWriter w(buffer, sizeof(buffer));
+    w.fixed(value, decimals);
+    return std::string(buffer, w.finish());
+}
+
+/// @brief The fields of a stream event, the record both encoders write.
+struct Record
+{
+    uint64_t timestamp;
+    uint16_t captureUs;
+    uint16_t analysisUs;
+    float decayTime;
+    float riseTime;
+    float pulseArea;
+    float neutronProbability;
+    float baseline;
+    bool neutron;
+    uint8_t samples[30];
+};
+
+size_t encodeWithWriter(const Record& r, char* buffer, size_t size)
+{
+    JsonWriter w(buffer, size);
+    w.key(PSTR("{\"timestamp\":"));
+    w.number64(r.timestamp);
+    w.key(PSTR(",\"capture_us\":"));
+    w.number(r.captureUs);
+    w.key(PSTR(",\"analysis_us\":"));
+    w.number(r.analysisUs);
+    w.key(PSTR(",\"decay_time\":"));
+    w.fixed(r.decayTime, 3);
+    w.key(PSTR(",\"rise_time\":"));
+    w.fixed(r.riseTime, 3);
+    w.key(PSTR(",\"pulse_area\":"));
+    w.fixed(r.pulseArea, 1);
+    w.key(PSTR(",\"neutron_probability\":"));
+    w.fixed(r.neutronProbability, 4);
+    w.key(PSTR(",\"baseline\":"));
+    w.fixed(r.baseline, 2);
+    w.key(PSTR(",\"is_neutron\":"));
+    w.boolean(r.neutron);
+    w.key(PSTR(",\"samples\":"));
+    w.array(r.samples, sizeof(r.samples));
+    w.raw('}');
+    return w.finish();
+}
+
+size_t encodeWithDocument(const Record& r, char* buffer, size_t size)
+{
+    StaticJsonDocument<1024> doc;
+    doc["timestamp"] = r.timestamp;
+    doc["capture_us"] = r.captureUs;
+    doc["analysis_us"] = r.analysisUs;
+    doc["decay_time"] = r.decayTime;
+    doc["rise_time"] = r.riseTime;
+    doc["pulse_area"] = r.pulseArea;
+    doc["neutron_probability"] = r.neutronProbability;
+    doc["baseline"] = r.baseline;
+    doc["is_neutron"] = r.neutron;
+    JsonArray samples = doc.createNestedArray("samples");
+    for (uint8_t s : r.samples) samples.add(s);
+    return serializeJson(doc, buffer, size);
+}
+
+}
+
+HOST_TEST(jsonFixedRoundsTheFractionOnly)
+{
+    // scaling the whole value in float rounded 123456.789 to 123456.7936
+    CHECK(writeFixed(123456.789f, 4) == "123456.7891");
+    CHECK(writeFixed(0.5f, 1) == "0.5");
+    CHECK(writeFixed(2.0f, 3) == "2");
+    CHECK(writeFixed(-1.25f, 1) == "-1.3");
+    CHECK(writeFixed(9.99996f, 4) == "10");
+    CHECK(writeFixed(-0.00001f, 4) == "0");
+    CHECK(writeFixed(4294967296.0f, 2) == "4294967296");
+    CHECK(writeFixed(NAN, 2) == "null");
+    CHECK(writeFixed(-INFINITY, 2) == "null");
+    CHECK(writeFixed(1e20f, 0) == "null");
+
+    // a double keeps the digits a float drops
+    CHECK(writeFixed(16777217.0, 0) == "16777217");
+    CHECK(writeFixed(1000000000000.125, 3) == "1000000000000.125");
+    CHECK(writeFixed(12345678.9 / 255.0, 3) == "48414.427");
+
+    // every float within half a unit of the last decimal kept
+    std::mt19937 random(53);
+    std::uniform_real_distribution<double> exponent(-3, 9);
+    uint32_t worst = 0;
+    double worstError = 0;
+    for (uint32_t i = 0; i < 200000; ++i)
+    {
+        const float value = (i % 2 ? -1 : 1) * (float)pow(10.0, exponent(random));
+        const uint8_t decimals = i % (JsonWriter::MAX_DECIMALS + 1);
+        const double unit = pow(10.0, -decimals);
+        const double error = fabs(strtod(writeFixed(value, decimals).c_str(), nullptr) - (double)value) / unit;
+        if (error > worstError)
+        {
+            worstError = error;
+            worst = i;
+        }
+    }
+    REPORT("largest rounding error %.6f of the last decimal, at sample %u\n", worstError, worst);
+    CHECK(worstError <= 0.5 + 1e-3);
+}
+
+HOST_TEST(jsonWriterOutrunsArduinoJson)
+{
+    std::mt19937 random(59);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::vector<Record> records(256);
+    for (Record& r : records)
+    {
+        r.timestamp = (1ULL << 32) + random();
+        r.captureUs = 300 + random() % 100;
+        r.analysisUs = 100 + random() % 500;
+        r.decayTime = 200 * unit(random);
+        r.riseTime = 50 * unit(random);
+        r.pulseArea = 5000 * unit(random);
+        r.neutronProbability = unit(random);
+        r.baseline = 20 + 10 * unit(random);
+        r.neutron = r.neutronProbability > 0.5f;
+        for (uint8_t& s : r.samples) s = random() % 256;
+    }
+
+    // the same values from both, within the rounding of the fixed decimals
+    char writer[1024];
+    char document[1024];
+    for (const Record& r : records)
+    {
+        const std::string a(writer, encodeWithWriter(r, writer, sizeof(writer)));
+        const std::string b(document, encodeWithDocument(r, document, sizeof(document)));
+        CHECK(host::jsonIntegers(a, "timestamp") == host::jsonIntegers(b, "timestamp"));
+        CHECK(host::jsonNumber(a, "analysis_us") == host::jsonNumber(b, "analysis_us"));
+        CHECK_NEAR(host::jsonNumber(a, "decay_time"), host::jsonNumber(b, "decay_time"), 0.0005 + 1e-6);
+        CHECK_NEAR(host::jsonNumber(a, "pulse_area"), host::jsonNumber(b, "pulse_area"), 0.05 + 1e-4);
+        CHECK_NEAR(host::jsonNumber(a, "neutron_probability"), host::jsonNumber(b, "neutron_probability"), 0.00005 + 1e-7);
+        CHECK(host::jsonArray(a, "samples") == host::jsonArray(b, "samples"));
+        CHECK((a.find("\"is_neutron\":true") != std::string::npos) == r.neutron);
+    }
+
+    auto nsPerRecord = [&records](size_t (*encode)(const Record&, char*, size_t), char* buffer)
+    {
+        double best = 1e30;
+        volatile size_t sink = 0;
+        for (int round = 0; round < 5; ++round)
+        {
+            const uint64_t start = host::wallNs();
+            for (const Record& r : records) sink = sink + encode(r, buffer, 1024);
+            best = std::min(best, (host::wallNs() - start) / (double)records.size());
+        }
+        return best;
+    };
+    const double writerNs = nsPerRecord(encodeWithWriter, writer);
+    const double documentNs = nsPerRecord(encodeWithDocument, document);
+    REPORT("stream event: JsonWriter %.0f ns, ArduinoJson document %.0f ns, %.1fx\n", writerNs, documentNs, documentNs / writerNs);
+    CHECK(writerNs < documentNs);
+}
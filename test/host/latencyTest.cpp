@@ -0,0 +1,75 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <map>
+
+HOST_TEST(latencySerializedOnceAtPublish)
+{
+    // micros() wraps during the run, the stamps are 64-bit
+    const uint64_t start = (1ULL << 32) - 2000000ULL;
+    host::reset(start, 43);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 50;
+    PulseSource source(config, start, 43);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+
+    // a subscriber polling every 50 ms
+    std::map<uint64_t, uint64_t> streamed;     // timestamp to serialized_us
+    uint32_t stages = 0;
+    uint32_t cursor = host::jsonNumber(server.request("/neutron/stream").body.str(), "cursor");
+    double nextPoll = host::now();
+    while (host::now() < start + 4e6)
+    {
+        detector.update();
+        delayMicroseconds(100);
+        if (host::now() < nextPoll) continue;
+        nextPoll += 50000;
+
+        std::string body = server.request(String("/neutron/stream?cursor=") + String(cursor)).body.str();
+        cursor = host::jsonNumber(body, "cursor");
+        const std::vector<uint64_t> timestamps = host::jsonIntegers(body, "timestamp");
+        const std::vector<uint64_t> serialized = host::jsonIntegers(body, "serialized_us");
+        const std::vector<uint64_t> capture = host::jsonIntegers(body, "capture_us");
+        const std::vector<uint64_t> analysis = host::jsonIntegers(body, "analysis_us");
+        const uint64_t deviceTime = host::jsonIntegers(body, "device_time").front();
+        CHECK(serialized.size() == timestamps.size());
+        for (size_t i = 0; i < timestamps.size() && i < serialized.size(); ++i)
+        {
+            streamed[timestamps[i]] = serialized[i];
+            if (serialized[i] >= capture[i] + analysis[i] && timestamps[i] + serialized[i] <= deviceTime) stages++;
+        }
+    }
+
+    // long after publication the history repeats the published value instead of the time of the request
+    detector.update();
+    delay(2000);
+    const std::string history = server.request("/neutron/history?count=30").body.str();
+    const std::vector<uint64_t> timestamps = host::jsonIntegers(history, "timestamp");
+    const std::vector<uint64_t> serialized = host::jsonIntegers(history, "serialized_us");
+    uint32_t matched = 0;
+    for (size_t i = 0; i < timestamps.size() && i < serialized.size(); ++i)
+    {
+        auto it = streamed.find(timestamps[i]);
+        if (it != streamed.end() && it->second == serialized[i]) matched++;
+    }
+    uint64_t slowest = 0;
+    for (const auto& e : streamed) slowest = std::max(slowest, e.second);
+    REPORT("%zu events streamed, slowest serialization %llu us after the trigger, %u of %zu history pulses match\n",
+           streamed.size(), (unsigned long long)slowest, matched, timestamps.size());
+
+    CHECK(streamed.size() > 50);
+    CHECK(stages == streamed.size());
+    CHECK(slowest < 10000);
+    CHECK(!timestamps.empty());
+    CHECK(matched == timestamps.size());
+}
@@ -0,0 +1,85 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <random>
+#include <type_traits>
+
+// built with a counter pipeline: edge trigger, raw capture, no pulse shape analysis, Feynman-Y only
+static_assert(std::is_same<NeutronDetector, BasicNeutronDetector<DefaultPolicies>>::value, "the sketch detector is the default pipeline");
+static_assert(std::is_same<DefaultPolicies::Trigger, EdgeTrigger>::value, "variant built without -DNEUTRON_TRIGGER=EdgeTrigger");
+static_assert(std::is_same<DefaultPolicies::Capture, RawCapture>::value, "variant built without -DNEUTRON_CAPTURE=RawCapture");
+static_assert(std::is_same<DefaultPolicies::Analyzer, CountingAnalyzer>::value, "variant built without -DNEUTRON_ANALYZER=CountingAnalyzer");
+static_assert(!DefaultPolicies::Sinks::has<NeutronCorrelation>(), "variant built with the correlation sink");
+
+HOST_TEST(counterPipelineCountsEveryTrigger)
+{
+    host::reset(1000, 47);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 200;
+    config.neutronFraction = 0.3;
+    PulseSource source(config, 1000, 47);
+
+    // later a quiet input with a step far above the threshold for 100 ms, like a preamplifier that recovers slowly
+    const double stepStart = 3e6;
+    const double stepEnd = stepStart + 100000;
+    bool step = false;
+    std::mt19937 random(47);
+    std::normal_distribution<double> noise(0, config.noiseRms);
+    host::setSignal([&](double t)
+    {
+        if (!step) return source(t);
+        return (int)lround(config.baseline + noise(random) + (t >= stepStart && t < stepEnd ? 600 : 0));
+    });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+
+    auto run = [&detector](double until)
+    {
+        while (host::now() < until)
+        {
+            detector.update();
+            delayMicroseconds(100);
+        }
+    };
+    run(2e6);
+
+    // gammas included, every trigger is a neutron to a counter
+    std::string stats = detector.getStatisticsJSON().str();
+    const double pulses = host::jsonNumber(stats, "total_pulses");
+    CHECK(pulses > 50);
+    CHECK(host::jsonNumber(stats, "neutron_count") == pulses);
+
+    // one conversion per sample keeps the spacing at the schedule, the filter stage would take 16 conversions
+    double spacing = 0;
+    for (uint16_t i = 0; i < detector.getPulseCount(); ++i)
+    {
+        const NeutronDetector::Pulse& p = detector.getPulse(i);
+        spacing += (double)p.sampleTimes[NeutronDetector::SAMPLES_PER_PULSE - 1] / (NeutronDetector::SAMPLES_PER_PULSE - 1);
+    }
+    spacing /= detector.getPulseCount();
+
+    // the step holds the input above the threshold for 50 dead times, the edge trigger fires once
+    step = true;
+    run(stepStart);
+    stats = detector.getStatisticsJSON().str();
+    const double beforeStep = host::jsonNumber(stats, "total_pulses");
+    run(stepEnd + 50000);
+    const double duringStep = host::jsonNumber(detector.getStatisticsJSON().str(), "total_pulses") - beforeStep;
+
+    REPORT("%.0f pulses all counted as neutrons, mean sample spacing %.1f us, %.0f triggers on a %.0f ms step\n",
+           pulses, spacing, duringStep, (stepEnd - stepStart) / 1000);
+    CHECK_NEAR(spacing, NeutronDetector::SAMPLE_INTERVAL_US, 1.0);
+    CHECK(duringStep == 1);
+
+    // dropped sinks have no endpoint
+    CHECK(server.request("/neutron/feynman").code == 200);
+    CHECK(server.request("/neutron/correlation").code == 404);
+}
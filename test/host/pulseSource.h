@@ -0,0 +1,132 @@
+// Simulated NE213 front end: baseline with drift and noise plus Poisson neutron and gamma pulses.
+#ifndef PULSE_SOURCE_H
+#define PULSE_SOURCE_H
+
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+/// @brief Analog input signal for host::setSignal(), events are generated lazily as time advances. \class PulseSource
+class PulseSource
+{
+public:
+
+    /// @brief Shape and rate parameters, amplitudes in 10-bit ADC counts. \struct Config
+    struct Config
+    {
+        double baseline = 24.0;
+        double driftAmplitude = 0.0;      // slow sinusoidal baseline drift
+        double driftPeriodUs = 60e6;
+        double noiseRms = 1.0;
+        double rateHz = 100.0;            // 0 for injected events only
+        double neutronFraction = 0.3;
+        double minAmplitude = 200.0;
+        double maxAmplitude = 700.0;
+        double neutronRiseUs = 15.0;
+        double neutronDecayUs = 70.0;
+        double gammaRiseUs = 1.5;
+        double gammaDecayUs = 7.0;
+    };
+
+    /// @brief One generated pulse. \struct Event
+    struct Event
+    {
+        double timeUs;
+        bool neutron;
+        double amplitude;
+    };
+
+    PulseSource(const Config& config, double startUs, uint32_t seed = 1)
+        : _config(config), _random(seed), _nextUs(startUs)
+    {
+        scheduleNext();
+    }
+
+    /**
+     * @brief Add a pulse at a given time, in addition to the Poisson ones.
+     * @param timeUs The start of the pulse.
+     * @param neutron true for the slow neutron shape, false for the fast gamma shape.
+     * @param amplitude The peak height above the baseline in ADC counts.
+     */
+    void inject(double timeUs, bool neutron, double amplitude)
+    {
+        Event e = { timeUs, neutron, amplitude };
+        auto it = _active.begin();
+        while (it != _active.end() && it->timeUs <= timeUs) ++it;
+        _active.insert(it, e);
+        _history.push_back(e);
+    }
+
+    /// @brief The ADC reading at a time, called by analogRead() through host::setSignal().
+    int operator()(double timeUs)
+    {
+        while (_config.rateHz > 0 && _nextUs <= timeUs)
+        {
+            bool neutron = std::uniform_real_distribution<double>(0, 1)(_random) < _config.neutronFraction;
+            double amplitude = std::uniform_real_distribution<double>(_config.minAmplitude, _config.maxAmplitude)(_random);
+            inject(_nextUs, neutron, amplitude);
+            scheduleNext();
+        }
+
+        // pulses older than ten decay times no longer contribute
+        while (!_active.empty() && timeUs - _active.front().timeUs > 10 * _config.neutronDecayUs) _active.pop_front();
+
+        double v = _config.baseline + std::normal_distribution<double>(0, _config.noiseRms)(_random);
+        if (_config.driftAmplitude > 0) v += _config.driftAmplitude * sin(2 * M_PI * timeUs / _config.driftPeriodUs);
+
+        for (const Event& e : _active)
+        {
+            if (e.timeUs > timeUs) break;
+            v += shape(e, timeUs - e.timeUs);
+        }
+        return (int)lround(v);
+    }
+
+    /**
+     * @brief The pulse height above the baseline at a time after the start of an event.
+     * @param e The event.
+     * @param t The time since the event start in microseconds.
+     */
+    double shape(const Event& e, double t) const
+    {
+        double rise = e.neutron ? _config.neutronRiseUs : _config.gammaRiseUs;
+        double decay = e.neutron ? _config.neutronDecayUs : _config.gammaDecayUs;
+        double peakTime = log(decay / rise) * decay * rise / (decay - rise);
+        double peak = exp(-peakTime / decay) - exp(-peakTime / rise);
+        return e.amplitude * (exp(-t / decay) - exp(-t / rise)) / peak;
+    }
+
+    /// @brief All events generated or injected so far.
+    const std::vector<Event>& history() const { return _history; }
+
+    /// @brief Count the events that started in a time window.
+    size_t countBetween(double fromUs, double toUs, int neutron = -1) const
+    {
+        size_t n = 0;
+        for (const Event& e : _history)
+        {
+            if (e.timeUs < fromUs || e.timeUs >= toUs) continue;
+            if (neutron >= 0 && e.neutron != (neutron == 1)) continue;
+            n++;
+        }
+        return n;
+    }
+
+    Config& config() { return _config; }
+
+private:
+    Config _config;
+    std::mt19937 _random;
+    double _nextUs;
+    std::deque<Event> _active;
+    std::vector<Event> _history;
+
+    void scheduleNext()
+    {
+        if (_config.rateHz <= 0) return;
+        _nextUs += std::exponential_distribution<double>(_config.rateHz / 1e6)(_random);
+    }
+};
+
+#endif // PULSE_SOURCE_H
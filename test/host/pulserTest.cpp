@@ -0,0 +1,60 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+
+HOST_TEST(pulserLiveFractionMatchesDeadTime)
+{
+    host::reset(1000, 71);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 150;
+    PulseSource source(config, 1000, 71);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    detector.begin();
+
+    // Poisson ticks sample the dead time without lining up with the triggers
+    detector.enablePulser(10000, true);
+
+    auto run = [&detector](double until)
+    {
+        while (host::now() < until)
+        {
+            detector.update();
+            delayMicroseconds(100);
+        }
+    };
+
+    // the input check connects after a second, the ticks before it are not counted here
+    run(host::now() + 1.5e6);
+    std::string stats = detector.getStatisticsJSON().str();
+    const double startUs = host::now();
+    const double triggers0 = host::jsonNumber(stats, "total_pulses");
+    const double requested0 = host::jsonNumber(stats, "pulser_requested");
+    const double recorded0 = host::jsonNumber(stats, "pulser_recorded");
+
+    const double seconds = 60;
+    run(startUs + seconds * 1e6);
+    stats = detector.getStatisticsJSON().str();
+    const double triggers = host::jsonNumber(stats, "total_pulses") - triggers0;
+    const double requested = host::jsonNumber(stats, "pulser_requested") - requested0;
+    const double recorded = host::jsonNumber(stats, "pulser_recorded") - recorded0;
+    const double elapsedUs = host::now() - startUs;
+
+    // non-paralyzable: every capture, real or forced, holds the input dead for DEAD_TIME_US
+    const double expected = 1 - (triggers + recorded) * NeutronDetector::DEAD_TIME_US / elapsedUs;
+    const double live = recorded / requested;
+    const double sigma = sqrt(live * (1 - live) / requested);
+    REPORT("%.0f triggers, %.0f of %.0f ticks recorded: live fraction %.4f +/- %.4f, %.4f from the dead time\n",
+           triggers, recorded, requested, live, sigma, expected);
+
+    CHECK(requested > 0.9 * seconds * 100);
+    CHECK_NEAR(live, expected, 4 * sigma);
+    CHECK_NEAR(host::jsonNumber(stats, "live_fraction"),
+               host::jsonNumber(stats, "pulser_recorded") / host::jsonNumber(stats, "pulser_requested"), 1e-4);
+}
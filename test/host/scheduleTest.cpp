@@ -0,0 +1,132 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+
+namespace
+{
+
+/// @brief A detector on a quiet input whose pulser forces a capture every 100 ms.
+struct PulserDetector
+{
+    NeutronDetector detector;
+    ESP8266WebServer server;
+
+    PulserDetector() : detector(A0)
+    {
+        host::reset(1000, 5);
+        host::setCosts(0.5);
+        LittleFS.format();
+        host::setSignal([](double) { return 24; });
+        detector.begin();
+        detector.registerHTTPEndpoints(server);
+        detector.enablePulser(100000);
+    }
+
+    void run(double us)
+    {
+        const double end = host::now() + us;
+        while (host::now() < end)
+        {
+            detector.update();
+            delayMicroseconds(100);
+        }
+    }
+};
+
+}
+
+HOST_TEST(scheduleUniformReportsRateAndJitter)
+{
+    // one oversampled reading takes about 30 us here, a 50 us schedule is met
+    PulserDetector d;
+    uint16_t offsets[NeutronDetector::SAMPLES_PER_PULSE];
+    for (uint8_t i = 0; i < NeutronDetector::SAMPLES_PER_PULSE; ++i) offsets[i] = i * 50;
+    CHECK(d.detector.setSampleSchedule(offsets));
+    d.run(2e6);
+
+    std::string stats = d.detector.getStatisticsJSON().str();
+    std::vector<double> times = host::jsonArray(d.server.request("/neutron/last").body.str(), "sample_times");
+    REPORT("uniform 50 us: %.1f Hz, jitter %.3f us\n", host::jsonNumber(stats, "sample_rate_hz"), host::jsonNumber(stats, "sample_jitter_us"));
+
+    CHECK(times.size() == NeutronDetector::SAMPLES_PER_PULSE);
+    CHECK_NEAR(times.back(), offsets[NeutronDetector::SAMPLES_PER_PULSE - 1], 2);
+    CHECK_NEAR(host::jsonNumber(stats, "sample_rate_hz"), 20000, 200);
+    CHECK(host::jsonNumber(stats, "sample_jitter_us") < 1.0);
+}
+
+HOST_TEST(scheduleOverrunShowsAsJitter)
+{
+    // the default 10 us schedule is faster than one oversampled reading, every sample comes later
+    PulserDetector d;
+    d.run(2e6);
+
+    std::string stats = d.detector.getStatisticsJSON().str();
+    std::vector<double> times = host::jsonArray(d.server.request("/neutron/last").body.str(), "sample_times");
+    REPORT("uniform 10 us: %.1f Hz, jitter %.3f us, last sample at %.0f us\n", host::jsonNumber(stats, "sample_rate_hz"),
+           host::jsonNumber(stats, "sample_jitter_us"), times.empty() ? 0.0 : times.back());
+
+    CHECK(host::jsonNumber(stats, "sample_rate_hz") < 50000);
+    CHECK(host::jsonNumber(stats, "sample_jitter_us") > 100);
+}
+
+HOST_TEST(scheduleGeometricJitterAgainstSchedule)
+{
+    PulserDetector d;
+    CHECK(d.detector.setGeometricSchedule(10, 40, 1.2f));
+    d.run(2e6);
+
+    // the intervals differ by design, only the deviation from the schedule is jitter
+    std::string stats = d.detector.getStatisticsJSON().str();
+    std::string last = d.server.request("/neutron/last").body.str();
+    std::vector<double> times = host::jsonArray(last, "sample_times");
+    REPORT("geometric: jitter %.3f us, last sample at %.0f us\n", host::jsonNumber(stats, "sample_jitter_us"), times.back());
+
+    CHECK(host::jsonNumber(stats, "sample_jitter_us") < 1.0);
+    CHECK(std::isnan(host::jsonNumber(stats, "sample_rate_hz")));
+    CHECK(std::isnan(host::jsonNumber(last, "sample_interval_us")));
+    CHECK(times.size() == NeutronDetector::SAMPLES_PER_PULSE);
+    for (size_t i = 1; i < times.size(); ++i)
+    {
+        CHECK(times[i] > times[i - 1]);
+    }
+}
+
+HOST_TEST(scheduleGeometricGrowthClamped)
+{
+    PulserDetector d;
+
+    // a start every 50 ms, so the pulses also carry tof_us
+    for (double t = host::now() + 1000; t < host::now() + 1.6e6; t += 50000) host::scheduleEdge(D6, t);
+    d.detector.enableStartInput(D6, NeutronDetector::TOF_BIN_AUTO);
+
+    // far too fast a growth for 16-bit offsets, lowered until the last sample fits
+    CHECK(d.detector.setGeometricSchedule(4, 10, 3.0f));
+    d.run(1.5e6);
+    std::string last = d.server.request("/neutron/last").body.str();
+    std::string minmax = d.server.request("/neutron/last?view=minmax").body.str();
+    std::string lttb = d.server.request("/neutron/last?view=lttb").body.str();
+    std::string history = d.server.request("/neutron/history?count=3&view=minmax").body.str();
+    std::vector<double> times = host::jsonArray(last, "sample_times");
+    REPORT("clamped: last sample at %.0f us, pulse JSON %zu bytes raw, %zu minmax, %zu lttb\n",
+           times.empty() ? 0.0 : times.back(), last.size(), minmax.size(), lttb.size());
+
+    // five digit sample times and two arrays still fit a stream frame
+    CHECK(!std::isnan(host::jsonNumber(last, "tof_us")));
+    CHECK(last.size() < NeutronDetector::STREAM_FRAME_MAX);
+    CHECK(host::jsonArray(minmax, "envelope_max").size() == NeutronDetector::SAMPLES_PER_PULSE);
+    CHECK(minmax.size() < NeutronDetector::STREAM_FRAME_MAX);
+    CHECK(host::jsonArray(lttb, "lttb_value").size() == NeutronDetector::SAMPLES_PER_PULSE);
+    CHECK(lttb.size() < NeutronDetector::STREAM_FRAME_MAX);
+    CHECK(host::jsonNumber(history, "count") == 3);
+    CHECK(history.find("pulse_too_large") == std::string::npos);
+
+    CHECK(times.size() == NeutronDetector::SAMPLES_PER_PULSE);
+    CHECK(!times.empty() && times.back() <= UINT16_MAX + 2.0);
+    CHECK(!times.empty() && times.back() > 60000);
+
+    // the dense part alone does not fit, nothing to clamp
+    CHECK(!d.detector.setGeometricSchedule(30, 5000, 1.0f));
+    CHECK(!d.detector.setGeometricSchedule(4, 0, 1.5f));
+    CHECK(!d.detector.setGeometricSchedule(4, 10, 0.5f));
+}
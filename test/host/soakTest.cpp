@@ -0,0 +1,251 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr double START_PERIOD_US = 20000;    // 50 Hz source start signal
+constexpr uint32_t TOF_BIN_US = 256;         // 64 bins cover 16 ms of the 20 ms period
+
+double soakSeconds()
+{
+    const char* value = getenv("SOAK_SECONDS");
+    return value ? atof(value) : 240;
+}
+
+/// @brief Invariant violations seen during a soak run, reported at the end instead of one failure per event.
+struct Violations
+{
+    uint32_t ringOrder = 0;         // stored pulses not in timestamp order
+    uint32_t futureTimestamp = 0;   // a pulse stamped after the current time
+    uint32_t newestWentBack = 0;    // the newest pulse older than the newest seen before
+    uint32_t sampleOrder = 0;       // sample times not strictly increasing
+    uint32_t captureTime = 0;       // captureUs saturated
+    uint32_t tofRange = 0;          // TOF beyond one start period, i.e. an aliased cycle count
+    uint32_t counters = 0;          // a counter went backwards or neutrons exceed pulses
+    uint32_t stream = 0;            // stream cursor or event order broken
+};
+
+}
+
+HOST_TEST(soakThroughClockWraps)
+{
+    // micros() wraps 30 s into the run and the 80 MHz cycle counter every 53.7 s
+    const uint64_t start = (1ULL << 32) - 30000000ULL;
+    const double end = start + soakSeconds() * 1e6;
+
+    host::reset(start, 7);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 200;
+    config.driftAmplitude = 3;
+    config.driftPeriodUs = 90e6;
+    PulseSource source(config, start + 1e6, 11);
+    host::setSignal([&source](double t) { return source(t); });
+
+    for (double t = start + 1000; t < end + START_PERIOD_US; t += START_PERIOD_US)
+    {
+        host::scheduleEdge(D6, t);
+    }
+
+    NeutronDetector detector(A0);
+    detector.enableStartInput(D6, TOF_BIN_US);
+    detector.begin();
+    ESP8266WebServer server;
+    detector.registerHTTPEndpoints(server);
+
+    Violations v;
+    uint64_t lastNewest = 0;
+    double lastTotal = 0;
+    double lastNeutrons = 0;
+    uint32_t cursor = 0;
+    uint64_t lastStreamTimestamp = 0;
+    uint32_t streamEvents = 0;
+    uint64_t loops = 0;
+    uint32_t tofChecked = 0;
+    std::vector<double> baselineErrors;
+    std::vector<double> windowCounts;       // pulses counted per 10 s, a wrap must not stall the trigger
+    double windowStart = 0;
+    double nextCheck = start + 1e6;
+    const uint64_t wallStart = host::wallNs();
+
+    while (host::now() < end)
+    {
+        detector.update();
+        delayMicroseconds(100);     // the sketch loop
+        loops++;
+
+        if (host::now() < nextCheck) continue;
+        nextCheck += 1e6;
+
+        const uint64_t now = micros64();
+        const uint16_t count = detector.getPulseCount();
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            const NeutronDetector::Pulse& p = detector.getPulse(i);
+            if (i > 0 && p.timestamp <= detector.getPulse(i - 1).timestamp) v.ringOrder++;
+            if (p.timestamp > now) v.futureTimestamp++;
+            if (p.captureUs == UINT16_MAX) v.captureTime++;
+            for (uint8_t s = 1; s < NeutronDetector::SAMPLES_PER_PULSE; ++s)
+            {
+                if (p.sampleTimes[s] <= p.sampleTimes[s - 1]) v.sampleOrder++;
+            }
+            if (p.tofCycles != NeutronDetector::TOF_INVALID)
+            {
+                tofChecked++;
+                if (p.tofCycles / 80.0 > START_PERIOD_US + 2000) v.tofRange++;
+            }
+        }
+        if (count > 0)
+        {
+            uint64_t newest = detector.getPulse(count - 1).timestamp;
+            if (newest < lastNewest) v.newestWentBack++;
+            lastNewest = newest;
+        }
+
+        std::string stats = detector.getStatisticsJSON().str();
+        double total = host::jsonNumber(stats, "total_pulses");
+        double neutrons = host::jsonNumber(stats, "neutron_count");
+        if (total < lastTotal || neutrons < lastNeutrons || neutrons > total) v.counters++;
+        lastTotal = total;
+        lastNeutrons = neutrons;
+
+        double drift = config.driftAmplitude * sin(2 * M_PI * host::now() / config.driftPeriodUs);
+        baselineErrors.push_back(fabs(host::jsonNumber(stats, "current_baseline") - config.baseline - drift));
+        if (baselineErrors.size() % 10 == 0)
+        {
+            // the first window includes the second before the source starts
+            if (baselineErrors.size() > 10) windowCounts.push_back(total - windowStart);
+            windowStart = total;
+        }
+
+        // a subscriber polling once a second, the cursor and the event times only move forward
+        std::string body = server.request(String("/neutron/stream?cursor=") + String(cursor)).body.str();
+        uint32_t next = host::jsonNumber(body, "cursor");
+        if ((int32_t)(next - cursor) < 0) v.stream++;
+        cursor = next;
+        for (uint64_t t : host::jsonIntegers(body, "timestamp"))
+        {
+            if (t <= lastStreamTimestamp) v.stream++;
+            lastStreamTimestamp = t;
+            streamEvents++;
+        }
+    }
+
+    const double wallSeconds = (host::wallNs() - wallStart) / 1e9;
+    const double simSeconds = (host::now() - start) / 1e6;
+    std::string stats = detector.getStatisticsJSON().str();
+    std::string tof = server.request("/neutron/tof").body.str();
+    const double total = host::jsonNumber(stats, "total_pulses");
+    const double neutrons = host::jsonNumber(stats, "neutron_count");
+    const size_t injected = source.countBetween(start, host::now());
+    const size_t injectedNeutrons = source.countBetween(start, host::now(), 1);
+    std::sort(baselineErrors.begin(), baselineErrors.end());
+    std::sort(windowCounts.begin(), windowCounts.end());
+    const double baselineError = baselineErrors[baselineErrors.size() / 2];
+    const double slowestWindow = windowCounts.front() / windowCounts[windowCounts.size() / 2];
+
+    REPORT("simulated %.0f s in %.2f s wall, %.0fx real time\n", simSeconds, wallSeconds, simSeconds / wallSeconds);
+    REPORT("%.0f update() calls/s wall, %.2f us wall per simulated loop, %.0f ADC reads per simulated second\n",
+           loops / wallSeconds, wallSeconds * 1e6 / loops, host::adcReads() / simSeconds);
+    REPORT("%zu pulses injected, %.0f counted (%.3f), %zu neutrons injected, %.0f counted\n",
+           injected, total, total / injected, injectedNeutrons, neutrons);
+    REPORT("%u streamed events, %u TOF values checked, TOF overflow %.0f, stale starts %.0f\n",
+           streamEvents, tofChecked, host::jsonNumber(tof, "overflow"), host::jsonNumber(tof, "stale_starts"));
+    REPORT("median baseline error %.2f counts, slowest 10 s window at %.2f of the median rate\n", baselineError, slowestWindow);
+
+    CHECK(v.ringOrder == 0);
+    CHECK(v.futureTimestamp == 0);
+    CHECK(v.newestWentBack == 0);
+    CHECK(v.sampleOrder == 0);
+    CHECK(v.captureTime == 0);
+    CHECK(v.tofRange == 0);
+    CHECK(v.counters == 0);
+    CHECK(v.stream == 0);
+    CHECK(tofChecked > 0);
+    CHECK(streamEvents > 0);
+    CHECK(host::jsonNumber(stats, "stream_dropped") == 0);
+
+    // polling, dead time and pile-up cost events, noise triggers would push the count above the injected one
+    CHECK(total <= injected);
+    CHECK(slowestWindow > 0.8);
+    CHECK(host::jsonNumber(tof, "stale_starts") == 0);
+    CHECK(baselineError < 3.0);
+}
+
+namespace
+{
+
+/// @brief Fifty well separated neutron pulses after a quiet second, returns how many of them were counted.
+double countBurst(NeutronDetector& detector, PulseSource& source, std::mt19937& random)
+{
+    const double burst = host::now() + 1e6;
+    const double before = host::jsonNumber(detector.getStatisticsJSON().str(), "total_pulses");
+    for (int i = 0; i < 50; i++)
+    {
+        // random phase against the polling loop, a fixed period would hit every pulse at the same point
+        source.inject(burst + i * 20000.0 + std::uniform_real_distribution<double>(0, 1000)(random), true, 400);
+    }
+    while (host::now() < burst + 50 * 20000.0)
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+    return host::jsonNumber(detector.getStatisticsJSON().str(), "total_pulses") - before;
+}
+
+}
+
+HOST_TEST(soakWeeksOfIdleThenPulses)
+{
+    // three weeks of an idle input in 10 s steps, micros() wraps about 420 times
+    const uint64_t start = 1000;
+    const double idleUs = 21 * 24 * 3600e6;
+
+    host::reset(start, 3);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 0;
+    PulseSource source(config, start, 5);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    detector.begin();
+    std::mt19937 random(9);
+    const double fresh = countBurst(detector, source, random);
+    const uint64_t lastFresh = detector.getPulse(detector.getPulseCount() - 1).timestamp;
+
+    const uint64_t wallStart = host::wallNs();
+    while (host::now() < start + idleUs)
+    {
+        detector.update();
+        host::advance(10e6);
+    }
+
+    // the same burst after the idle time must be counted as well and stamped in order
+    const double later = countBurst(detector, source, random);
+    std::string stats = detector.getStatisticsJSON().str();
+    REPORT("%.0f days idle in %.2f s wall, %.0f of 50 pulses counted before it and %.0f after it\n",
+           idleUs / 86400e6, (host::wallNs() - wallStart) / 1e9, fresh, later);
+
+    CHECK(fresh >= 25);
+    CHECK_NEAR(later, fresh, 5);
+    CHECK(detector.getPulseCount() == NeutronDetector::MAX_PULSES);
+    for (uint16_t i = 1; i < detector.getPulseCount(); ++i)
+    {
+        CHECK(detector.getPulse(i).timestamp > detector.getPulse(i - 1).timestamp);
+    }
+    CHECK(detector.getPulse(0).timestamp > lastFresh + idleUs - 2e6);
+    const double checkpoints = idleUs / NeutronDetector::CHECKPOINT_INTERVAL_US;
+    CHECK_NEAR(host::jsonNumber(stats, "checkpoint_count"), checkpoints, checkpoints * 0.001);
+}
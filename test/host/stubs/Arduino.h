@@ -0,0 +1,210 @@
+// Host stand-in for the ESP8266 Arduino core, just the part the detector uses. Time, the ADC and the
+// interrupt inputs are driven by the virtual clock and signal of hostHarness.h.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+
+using std::fabs;
+using std::isfinite;
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+static const uint8_t A0 = 17;
+static const uint8_t D5 = 14;
+static const uint8_t D6 = 12;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+
+inline uint8_t pgm_read_byte(const void* p) { return *(const uint8_t*)p; }
+inline uint16_t pgm_read_word(const void* p) { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t pgm_read_dword(const void* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline void* memcpy_P(void* dest, const void* src, size_t n) { return memcpy(dest, src, n); }
+inline size_t strlen_P(const char* s) { return strlen(s); }
+
+// unsigned long is 32 bits on the ESP8266, the host keeps that width so differences wrap the same way
+uint32_t micros();
+uint32_t millis();
+uint64_t micros64();
+void delayMicroseconds(unsigned int us);
+void delay(unsigned long ms);
+void yield();
+
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts();
+void interrupts();
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+/// @brief Arduino String on top of std::string. \class String
+class String
+{
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(long long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long long v) : _s(std::to_string(v)) {}
+    explicit String(float v, unsigned char decimals = 2) { format(v, decimals); }
+    explicit String(double v, unsigned char decimals = 2) { format(v, decimals); }
+
+    const char* c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(size_t n) { _s.reserve(n); return true; }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return atof(_s.c_str()); }
+    char operator[](size_t i) const { return i < _s.size() ? _s[i] : 0; }
+    void remove(size_t index) { if (index < _s.size()) _s.erase(index); }
+    void remove(size_t index, size_t count) { if (index < _s.size()) _s.erase(index, count); }
+    bool startsWith(const String& s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+    int indexOf(char c, size_t from = 0) const { size_t i = _s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+    String substring(size_t from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(size_t from, size_t to) const { return from < _s.size() ? String(_s.substr(from, to - from)) : String(); }
+
+    bool concat(const char* s) { _s += s; return true; }
+    bool concat(const char* s, size_t n) { _s.append(s, n); return true; }
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(char c) { _s += c; return true; }
+
+    String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == o; }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool operator!=(const char* o) const { return _s != o; }
+
+    const std::string& str() const { return _s; }
+
+private:
+    std::string _s;
+
+    void format(double v, unsigned char decimals)
+    {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, v);
+        _s = buffer;
+    }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+
+class StringSumHelper : public String
+{
+public:
+    using String::String;
+};
+
+/// @brief Byte sink base class of Serial, clients and StreamString. \class Print
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char* s, size_t n) { return write((const uint8_t*)s, n); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+    template <typename T>
+    size_t println(const T& v) { return print(v) + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write(buffer, min((size_t)n, sizeof(buffer) - 1));
+    }
+};
+
+/// @brief Readable byte stream. \class Stream
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+};
+
+/// @brief Serial port, echoed to stdout when HOST_VERBOSE is set. \class HardwareSerial
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+/// @brief ESP object, the cycle counter follows the virtual clock. \class EspClass
+class EspClass
+{
+public:
+    uint32_t getCycleCount();
+    uint8_t getCpuFreqMHz() { return 80; }
+    uint32_t getFreeHeap() { return 40000; }
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,65 @@
+// Host stand-in for ESP8266WebServer: handlers are called directly by request() and the response is
+// collected chunk by chunk, so tests see exactly what a client would receive.
+#ifndef HOST_ESP8266_WEB_SERVER_H
+#define HOST_ESP8266_WEB_SERVER_H
+
+#include <ESP8266WiFi.h>
+#include <map>
+#include <vector>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+/// @brief Mock web server. \class ESP8266WebServer
+class ESP8266WebServer
+{
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    /// @brief What the client received for one request. \struct Response
+    struct Response
+    {
+        int code = 0;
+        String body;
+        size_t chunks = 0;       // sendContent() calls with data
+        size_t maxChunk = 0;     // largest single write in bytes
+        bool chunked = false;
+        bool complete = false;   // plain send(), or the terminating empty chunk was sent
+    };
+
+    explicit ESP8266WebServer(int port = 80) { (void)port; }
+
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void begin() {}
+    void handleClient() {}
+
+    String arg(const String& name) const;
+    bool hasArg(const String& name) const;
+
+    void setContentLength(size_t length) { _contentLength = length; }
+    void send(int code, const char* contentType, const String& body);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t length);
+
+    WiFiClient& client() { return _client; }
+
+    /**
+     * @brief Run the handler of a GET request like "/neutron/history?count=3".
+     * @param uri The path with an optional query string.
+     * @param dropAfterBytes Disconnect the client after this many body bytes, 0 never.
+     * @return Response What reached the client, code 404 if no handler matched.
+     */
+    Response request(const String& uri, size_t dropAfterBytes = 0);
+
+private:
+    std::map<std::string, THandlerFunction> _handlers;
+    std::map<std::string, std::string> _args;
+    WiFiClient _client;
+    Response _response;
+    size_t _contentLength = 0;
+
+    void deliver(const char* data, size_t length);
+};
+
+#endif // HOST_ESP8266_WEB_SERVER_H
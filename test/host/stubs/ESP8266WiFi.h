@@ -0,0 +1,63 @@
+// Host stand-in for the ESP8266 WiFi library, the client connection is controlled by the harness.
+#ifndef HOST_ESP8266_WIFI_H
+#define HOST_ESP8266_WIFI_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define WIFI_AP 2
+
+/// @brief IPv4 address. \class IPAddress
+class IPAddress
+{
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _octets{ a, b, c, d } {}
+
+private:
+    uint8_t _octets[4];
+};
+
+struct WiFiEventSoftAPModeStationConnected {};
+struct WiFiEventSoftAPModeStationDisconnected {};
+typedef std::shared_ptr<void> WiFiEventHandler;
+
+/// @brief TCP client of the mock web server, counts the bytes sent and can drop mid-response. \class WiFiClient
+class WiFiClient : public Stream
+{
+public:
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    bool connected() const { return _connected; }
+    void stop() { _connected = false; }
+
+    /**
+     * @brief Open a new connection for the next request.
+     * @param dropAfterBytes Disconnect once this many bytes were sent, 0 never.
+     */
+    void open(size_t dropAfterBytes = 0);
+
+    size_t bytesSent() const { return _sent; }
+
+private:
+    bool _connected = true;
+    size_t _sent = 0;
+    size_t _dropAfter = 0;
+};
+
+/// @brief Soft AP control, all no-ops on the host. \class WiFiClass
+class WiFiClass
+{
+public:
+    void mode(int) {}
+    void softAPConfig(IPAddress, IPAddress, IPAddress) {}
+    void softAP(const char*, const char*) {}
+    IPAddress softAPIP() { return IPAddress(192, 168, 1, 6); }
+    WiFiEventHandler onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected&)>) { return nullptr; }
+    WiFiEventHandler onSoftAPModeStationDisconnected(std::function<void(const WiFiEventSoftAPModeStationDisconnected&)>) { return nullptr; }
+};
+
+extern WiFiClass WiFi;
+
+#endif // HOST_ESP8266_WIFI_H
@@ -0,0 +1,76 @@
+// Host stand-in for LittleFS, an in-memory file system that can simulate a power cut.
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+/// @brief Open file handle, writes go straight to the in-memory file. \class File
+class File : public Stream
+{
+public:
+    File() {}
+    File(std::shared_ptr<std::vector<uint8_t>> data, bool writable, size_t position)
+        : _data(data), _writable(writable), _position(position) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    size_t read(uint8_t* buffer, size_t size);
+    int read() override { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    int available() override { return _data ? (int)(_data->size() - _position) : 0; }
+    size_t size() const { return _data ? _data->size() : 0; }
+    size_t position() const { return _position; }
+    bool seek(uint32_t position) { if (!_data || position > _data->size()) return false; _position = position; return true; }
+    void close() { _data.reset(); }
+    explicit operator bool() const { return (bool)_data; }
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> _data;
+    bool _writable = false;
+    size_t _position = 0;
+};
+
+/// @brief In-memory file system. \class FS
+class FS
+{
+public:
+    bool begin() { return true; }
+    bool format() { _files.clear(); return true; }
+    File open(const char* path, const char* mode);
+    bool exists(const char* path) const { return _files.count(path) > 0; }
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+
+    // host side
+
+    /**
+     * @brief Let only the next n mutating operations (writes, renames, removes) through, like a power cut.
+     * @param operations The number of operations that still reach the flash, -1 for no limit.
+     */
+    void cutPowerAfter(long operations) { _budget = operations; }
+
+    /// @brief The number of mutating operations so far.
+    long operations() const { return _operations; }
+
+    /// @brief Copy of all files, to compare or restore a flash image.
+    std::map<std::string, std::vector<uint8_t>> image() const;
+
+    /// @brief Replace all files with an image.
+    void load(const std::map<std::string, std::vector<uint8_t>>& image);
+
+    /// @brief Account a mutating operation, false if the power is already cut.
+    bool mutate();
+
+private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> _files;
+    long _budget = -1;
+    long _operations = 0;
+};
+
+extern FS LittleFS;
+
+#endif // HOST_LITTLEFS_H
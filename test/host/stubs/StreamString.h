@@ -0,0 +1,16 @@
+// Host stand-in for StreamString.
+#ifndef HOST_STREAM_STRING_H
+#define HOST_STREAM_STRING_H
+
+#include <Arduino.h>
+
+/// @brief String that can be printed to. \class StreamString
+class StreamString : public String, public Stream
+{
+public:
+    size_t write(uint8_t c) override { concat((char)c); return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { concat((const char*)buffer, size); return size; }
+    using Print::write;
+};
+
+#endif // HOST_STREAM_STRING_H
@@ -0,0 +1,121 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+
+HOST_TEST(traceIsSentInSlices)
+{
+    host::reset(1000, 37);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 500;
+    PulseSource source(config, 1000, 37);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+
+    auto run = [&detector](double us)
+    {
+        const double end = host::now() + us;
+        while (host::now() < end)
+        {
+            detector.update();
+            delayMicroseconds(100);
+        }
+    };
+    run(1e6);
+
+    ESP8266WebServer::Response r = server.request("/neutron/trace");
+    const std::string body = r.body.str();
+    const std::vector<uint64_t> ts = host::jsonIntegers(body, "ts");
+    REPORT("%zu bytes in %zu chunks, largest %zu bytes, %zu events\n", body.size(), r.chunks, r.maxChunk, ts.size());
+
+    // the full ring, never more than one slice in memory, and only the events recorded before the request
+    CHECK(r.complete);
+    CHECK(r.chunked);
+    CHECK(ts.size() == StageTrace::RING_SIZE);
+    CHECK(r.maxChunk <= NeutronDetector::RESPONSE_SLICE_BYTES);
+    CHECK(r.chunks >= body.size() / NeutronDetector::RESPONSE_SLICE_BYTES);
+    CHECK(body.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{", 0) == 0);
+    CHECK(body.size() >= 2 && body.compare(body.size() - 2, 2, "]}") == 0);
+    for (size_t i = 1; i < ts.size(); ++i)
+    {
+        CHECK(ts[i] >= ts[i - 1]);
+    }
+
+    // recording resumes after the response, a cleared ring only holds what came after the clear
+    CHECK(server.request("/neutron/trace?clear=1").complete);
+    run(500);
+    const std::vector<uint64_t> fresh = host::jsonIntegers(server.request("/neutron/trace").body.str(), "ts");
+    CHECK(!fresh.empty());
+    CHECK(fresh.size() < StageTrace::RING_SIZE);
+}
+
+HOST_TEST(traceRawDumpMatchesChromeJSON)
+{
+    host::reset(1000, 41);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 500;
+    PulseSource source(config, 1000, 41);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    ESP8266WebServer server;
+    detector.begin();
+    detector.registerHTTPEndpoints(server);
+    for (double end = host::now() + 1e6; host::now() < end; )
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+
+    // recording pauses during each export, so both see the same ring
+    uint64_t start = host::wallNs();
+    ESP8266WebServer::Response r = server.request("/neutron/trace?format=raw");
+    const double rawNs = host::wallNs() - start;
+    start = host::wallNs();
+    const std::string json = server.request("/neutron/trace").body.str();
+    const double jsonNs = host::wallNs() - start;
+    const std::string raw = r.body.str();
+    REPORT("raw dump %zu bytes in %.0f us, Chrome JSON %zu bytes in %.0f us\n", raw.size(), rawNs / 1000, json.size(), jsonNs / 1000);
+
+    CHECK(r.complete);
+    CHECK(r.maxChunk <= NeutronDetector::RESPONSE_SLICE_BYTES);
+    CHECK(raw.size() == StageTrace::RAW_HEADER_BYTES + StageTrace::RING_SIZE * StageTrace::RAW_RECORD_BYTES);
+    CHECK(raw.size() >= StageTrace::RAW_HEADER_BYTES && raw.compare(0, 4, "NTRC") == 0);
+    CHECK(raw.size() * 5 < json.size());
+    if (raw.size() < StageTrace::RAW_HEADER_BYTES) return;
+
+    // what tools/traceToChrome.py does: unwrap the counter, whole microseconds from the first record
+    auto byte = [&raw](size_t at) { return (uint8_t)raw[at]; };
+    const uint8_t mhz = byte(5);
+    const uint16_t count = byte(6) | byte(7) << 8;
+    const std::vector<uint64_t> ts = host::jsonIntegers(json, "ts");
+    CHECK(byte(4) == StageTrace::RAW_VERSION);
+    CHECK(count == ts.size());
+
+    uint64_t offset = 0;
+    uint32_t base = 0;
+    uint32_t previous = 0;
+    uint32_t mismatches = 0;
+    for (uint16_t i = 0; i < count && i < ts.size(); ++i)
+    {
+        const size_t at = StageTrace::RAW_HEADER_BYTES + i * StageTrace::RAW_RECORD_BYTES;
+        const uint32_t cycles = byte(at) | byte(at + 1) << 8 | byte(at + 2) << 16 | (uint32_t)byte(at + 3) << 24;
+        if (i == 0) base = previous = cycles;
+        if (cycles < previous) offset += 1ULL << 32;
+        previous = cycles;
+        if ((offset + cycles - base) / mhz != ts[i]) mismatches++;
+        if (byte(at + 4) >= (uint8_t)TraceStage::COUNT) mismatches++;
+    }
+    CHECK(mismatches == 0);
+}
@@ -0,0 +1,68 @@
+#include "hostTest.h"
+#include "hostHarness.h"
+#include "pulseSource.h"
+#include "neutronDetector.h"
+#include <LittleFS.h>
+#include <random>
+
+HOST_TEST(vetoTakesBackExactlyWhatWasCounted)
+{
+    host::reset(1000, 13);
+    host::setCosts(0.5);
+    LittleFS.format();
+
+    PulseSource::Config config;
+    config.rateHz = 0;
+    PulseSource source(config, 1000, 13);
+    host::setSignal([&source](double t) { return source(t); });
+
+    NeutronDetector detector(A0);
+    detector.begin();
+    detector.enableVeto(D5);
+
+    // mixed pulses 20 ms apart, every third one followed by a veto edge; all of them fit the ring
+    std::mt19937 random(4);
+    const double first = host::now() + 1e6;
+    const int pulses = 24;
+    for (int i = 0; i < pulses; ++i)
+    {
+        const double t = first + i * 20000.0 + std::uniform_real_distribution<double>(0, 1000)(random);
+        source.inject(t, i % 2 == 0, std::uniform_real_distribution<double>(200, 700)(random));
+        if (i % 3 == 0) host::scheduleEdge(D5, t + 20);
+    }
+    while (host::now() < first + pulses * 20000.0 + 100000)
+    {
+        detector.update();
+        delayMicroseconds(100);
+    }
+
+    // the counts are rebuilt from the stored Q8 probabilities of the pulses left standing
+    double expected = 0;
+    double variance = 0;
+    uint32_t standing = 0;
+    uint32_t vetoed = 0;
+    for (uint16_t i = 0; i < detector.getPulseCount(); ++i)
+    {
+        const NeutronDetector::Pulse& p = detector.getPulse(i);
+        if (p.flags & NeutronDetector::PULSE_FLAG_VETOED)
+        {
+            vetoed++;
+            continue;
+        }
+        const double prob = p.neutronProbability / 255.0;
+        expected += prob;
+        variance += prob * (1 - prob);
+        standing++;
+    }
+
+    std::string stats = detector.getStatisticsJSON().str();
+    REPORT("%u pulses standing, %u vetoed, expected neutrons %.3f of %.3f rebuilt\n", standing, vetoed,
+           host::jsonNumber(stats, "neutron_expected"), expected);
+
+    // polling misses some pulses, enough of both kinds are left
+    CHECK(vetoed >= pulses / 6);
+    CHECK(standing >= pulses / 3);
+    CHECK(host::jsonNumber(stats, "total_pulses") == standing);
+    CHECK_NEAR(host::jsonNumber(stats, "neutron_expected"), expected, 0.0005);
+    CHECK_NEAR(host::jsonNumber(stats, "neutron_class_variance"), variance, 0.0005);
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Trigger-to-client latency of the neutron detector event stream, broken down by stage.
+
+The probe syncs to the device clock through /neutron/time, keeping the round trip with the
+smallest delay like NTP does, then polls /neutron/stream. Each event carries its trigger
+timestamp and the stage times the device measured. The probe adds the time the event waited
+in the stream ring and the time the response took to arrive:
+
+    capture        trigger to the last sample                      capture_us
+    analysis       feature extraction and classification           analysis_us
+    serialization  end of the analysis to the encoded stream frame serialized_us - capture_us - analysis_us
+    queueing       encoded frame to the poll that returns it       device_time - timestamp - serialized_us
+    transport      poll response to its arrival at this host       receive time on the device clock - device_time
+    total          trigger to arrival                              receive time on the device clock - timestamp
+
+Usage: latencyProbe.py [--duration 60] [--interval 0.1] [--json] http://neutron-detector.local
+"""
+
+import argparse
+import json
+import sys
+import time
+import urllib.request
+
+STAGES = ["capture", "analysis", "serialization", "queueing", "transport", "total"]
+PERCENTILES = [50, 90, 99]
+
+
+def fetch(base, path, timeout):
+    """GET a JSON endpoint, returns the body and the host send and receive times in microseconds."""
+    sent = time.monotonic_ns() // 1000
+    with urllib.request.urlopen(base + path, timeout=timeout) as response:
+        body = json.loads(response.read())
+    received = time.monotonic_ns() // 1000
+    return body, sent, received
+
+
+class ClockSync:
+    """Offset of the device clock against the host monotonic clock, from the tightest round trips."""
+
+    def __init__(self, base, timeout, samples=16):
+        self.base = base
+        self.timeout = timeout
+        self.samples = samples
+        self.offset = 0
+        self.rtt = None
+
+    def sync(self):
+        """Take a burst of /neutron/time samples and keep the one with the shortest round trip."""
+        best = None
+        for _ in range(self.samples):
+            body, sent, received = fetch(self.base, "/neutron/time", self.timeout)
+            rtt = received - sent
+            if best is None or rtt < best[0]:
+                # the device read its clock somewhere in the round trip, the middle is off by at most rtt / 2
+                best = (rtt, body["device_time"] - (sent + received) // 2)
+        self.rtt, self.offset = best
+
+    def to_device(self, host_us):
+        return host_us + self.offset
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, max(0, round(p / 100 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def stages_of(event, device_time, received_device):
+    timestamp = event["timestamp"]
+    serialized = event.get("serialized_us")
+    if serialized is None:
+        return None
+    return {
+        "capture": event["capture_us"],
+        "analysis": event["analysis_us"],
+        "serialization": serialized - event["capture_us"] - event["analysis_us"],
+        "queueing": device_time - timestamp - serialized,
+        "transport": received_device - device_time,
+        "total": received_device - timestamp,
+    }
+
+
+def report(samples, clock, as_json):
+    summary = {}
+    for stage in STAGES:
+        values = [s[stage] for s in samples]
+        if not values:
+            continue
+        summary[stage] = {"min": min(values), "max": max(values)}
+        summary[stage].update({"p%d" % p: percentile(values, p) for p in PERCENTILES})
+
+    if as_json:
+        print(json.dumps({"events": len(samples), "sync_rtt_us": clock.rtt, "stages_us": summary}, indent=2))
+        return
+
+    print("%d events, clock sync round trip %d us (transport and total are uncertain by half of it)" % (len(samples), clock.rtt))
+    print("%-14s %9s %9s %9s %9s %9s" % ("stage [us]", "min", "p50", "p90", "p99", "max"))
+    for stage, s in summary.items():
+        print("%-14s %9d %9d %9d %9d %9d" % (stage, s["min"], s["p50"], s["p90"], s["p99"], s["max"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("url", help="base URL of the detector, e.g. http://192.168.4.1")
+    parser.add_argument("--duration", type=float, default=60, help="seconds to collect events")
+    parser.add_argument("--interval", type=float, default=0.1, help="seconds between stream polls")
+    parser.add_argument("--resync", type=float, default=10, help="seconds between clock syncs, the clocks drift apart")
+    parser.add_argument("--timeout", type=float, default=5, help="HTTP timeout in seconds")
+    parser.add_argument("--json", action="store_true", help="print the distribution as JSON")
+    args = parser.parse_args()
+    base = args.url.rstrip("/")
+
+    clock = ClockSync(base, args.timeout)
+    clock.sync()
+    last_sync = time.monotonic()
+
+    # start at the head of the ring, older events would count their wait before the probe started
+    body, _, _ = fetch(base, "/neutron/stream", args.timeout)
+    cursor = body["cursor"]
+    for _ in range(100):
+        body, _, _ = fetch(base, "/neutron/stream?cursor=%d" % cursor, args.timeout)
+        if not body["events"]:
+            break
+        cursor = body["cursor"]
+
+    samples = []
+    skipped = 0
+    end = time.monotonic() + args.duration
+    while time.monotonic() < end:
+        if time.monotonic() - last_sync > args.resync:
+            clock.sync()
+            last_sync = time.monotonic()
+
+        body, _, received = fetch(base, "/neutron/stream?cursor=%d" % cursor, args.timeout)
+        cursor = body["cursor"]
+        skipped += body.get("skipped", 0)
+        received_device = clock.to_device(received)
+        for event in body["events"]:
+            stages = stages_of(event, body["device_time"], received_device)
+            if stages is not None:
+                samples.append(stages)
+        time.sleep(args.interval)
+
+    if skipped:
+        print("warning: %d events were overwritten before they were polled, poll faster" % skipped, file=sys.stderr)
+    if not samples:
+        print("no events received", file=sys.stderr)
+        return 1
+    report(samples, clock, args.json)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Convert the raw stage trace of the neutron detector to Chrome/Perfetto trace JSON.
+
+Firmware built with -DNEUTRON_TRACE=1 serves its trace ring unformatted at /neutron/trace?format=raw:
+
+    header   "NTRC", version, CPU clock in MHz, record count as uint16
+    records  cycle count as uint32, stage, phase ('B' begin, 'E' end, 'i' instant)
+
+Little endian, oldest record first. The cycle counter wraps every 53 s at 80 MHz, the records are in
+order so each wrap shows as a step back. The output opens in chrome://tracing or ui.perfetto.dev
+and matches the JSON the device writes itself at /neutron/trace.
+
+Usage: traceToChrome.py [--clear] [-o trace.json] (http://neutron-detector.local | trace.bin)
+"""
+
+import argparse
+import json
+import struct
+import sys
+import urllib.request
+
+MAGIC = b"NTRC"
+VERSION = 1
+HEADER = struct.Struct("<4sBBH")
+RECORD = struct.Struct("<IBB")
+
+# in the order of TraceStage in stageTrace.h
+STAGES = ["acquisition", "analysis", "serialization", "transport", "handle_client", "wifi"]
+
+
+def load(source, clear, timeout):
+    """Read a dump from a file, or fetch it from the device when the source is a URL."""
+    if not source.startswith("http://") and not source.startswith("https://"):
+        with open(source, "rb") as f:
+            return f.read()
+    url = source.rstrip("/") + "/neutron/trace?format=raw" + ("&clear=1" if clear else "")
+    with urllib.request.urlopen(url, timeout=timeout) as response:
+        return response.read()
+
+
+def parse(dump):
+    """Split a dump into the CPU clock and the (cycles, stage, phase) records, checking the header."""
+    if len(dump) < HEADER.size:
+        raise ValueError("%d bytes, shorter than the header" % len(dump))
+    magic, version, mhz, count = HEADER.unpack_from(dump)
+    if magic != MAGIC:
+        raise ValueError("not a trace dump, magic %r" % magic)
+    if version != VERSION:
+        raise ValueError("dump version %d, this converter reads version %d" % (version, VERSION))
+    if len(dump) != HEADER.size + count * RECORD.size:
+        raise ValueError("%d bytes for %d records, the dump is truncated" % (len(dump), count))
+    return mhz, [RECORD.unpack_from(dump, HEADER.size + i * RECORD.size) for i in range(count)]
+
+
+def to_chrome(mhz, records):
+    """Unwrap the cycle counter and turn the records into trace events, in microseconds from the first.
+
+    The fraction is cut to whole nanoseconds like the device does, so both exports give the same ts.
+    """
+    events = []
+    offset = 0
+    base = records[0][0] if records else 0
+    previous = base
+    for cycles, stage, phase in records:
+        if cycles < previous:
+            offset += 1 << 32
+        previous = cycles
+        ticks = offset + cycles - base
+        event = {
+            "name": STAGES[stage] if stage < len(STAGES) else STAGES[0],
+            "ph": chr(phase),
+            "ts": ticks // mhz + (ticks % mhz) * 1000 // mhz / 1000,
+            "pid": 1,
+            "tid": 1,
+        }
+        if event["ph"] == "i":
+            event["s"] = "t"
+        events.append(event)
+    return {"displayTimeUnit": "ms", "traceEvents": events}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="base URL of the detector, e.g. http://192.168.4.1, or a saved dump")
+    parser.add_argument("-o", "--output", help="trace JSON file, standard output without it")
+    parser.add_argument("--clear", action="store_true", help="clear the ring on the device after reading it")
+    parser.add_argument("--timeout", type=float, default=5, help="HTTP timeout in seconds")
+    args = parser.parse_args()
+
+    try:
+        mhz, records = parse(load(args.source, args.clear, args.timeout))
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    trace = to_chrome(mhz, records)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        print()
+    print("%d events over %.1f ms at %d MHz" % (len(records), trace["traceEvents"][-1]["ts"] / 1000 if records else 0, mhz),
+          file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())